@@ -0,0 +1,319 @@
+/*
+ * Benchmark do motor de desgaste. Mede as funcoes de abrasion.c e o caminho
+ * por amostra contra o caminho em lote e o lote segmentado em viagens
+ * (wear_trip.h), para janelas de 200, 1024 e 65536 amostras, e os componentes
+ * extras de wear_component.h, em um fluxo sintetico, no mesmo fluxo com 35%
+ * de marcha lenta e opcionalmente num fluxo gravado (int16 little-endian rpm,
+ * spd, brk por amostra, ver export_stream.py). A saida e JSON em stdout.
+ *
+ * uso: abrasion_bench [fluxo.bin]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "abrasion.h"
+#include "wear_trip.h"
+#include "wear_component.h"
+
+#define SYNTH_SAMPLES	(1 << 20)
+#define IDLE_PERIOD		2000	//a cada IDLE_PERIOD amostras, as ultimas IDLE_RUN paradas em marcha lenta
+#define IDLE_RUN		700
+#define MIN_SECONDS		0.2
+
+#if defined(__AVX2__)
+#define SIMD_NAME "avx2"
+#elif defined(__SSE2__)
+#define SIMD_NAME "sse2"
+#else
+#define SIMD_NAME "none"
+#endif
+
+typedef struct {
+	const char *name;
+	int16_t *rpm, *spd, *brk;
+	size_t n;
+} stream_t;
+
+static volatile unsigned char sink;
+static int first_result = 1;
+
+
+static double now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+
+static int allocStream(stream_t *s, const char *name, size_t n) {
+	s->name = name;
+	s->n = n;
+	s->rpm = (int16_t *) malloc(n*sizeof(int16_t));
+	s->spd = (int16_t *) malloc(n*sizeof(int16_t));
+	s->brk = (int16_t *) malloc(n*sizeof(int16_t));
+	return s->rpm != NULL && s->spd != NULL && s->brk != NULL;
+}
+
+
+static void synthStream(stream_t *s) {	//passeio aleatorio parecido com os logs do comma.ai
+	unsigned long seed = 12345;
+	int rpm = 800, spd = 0, brk = 0;
+	static const int brk_step[] = {0, 0, 0, -70, 70, 20, -20, 300, -300};
+
+	for (size_t i = 0; i < s->n; i++) {
+		seed = seed*1103515245 + 12345;
+		rpm += (int) ((seed >> 16) % 121) - 60;
+		spd += (int) ((seed >> 8) % 5) - 2;
+		brk += brk_step[(seed >> 24) % 9];
+		rpm = (rpm < 0)? 0: (rpm > 8000)? 8000: rpm;
+		spd = (spd < 0)? 0: (spd > 40)? 40: spd;
+		brk = (brk < 0)? 0: (brk > 4095)? 4095: brk;
+		s->rpm[i] = rpm;
+		s->spd[i] = spd;
+		s->brk[i] = brk;
+	}
+}
+
+
+static void idleStream(stream_t *dst, const stream_t *src) {	//paradas longas, como nos logs reais
+	for (size_t i = 0; i < src->n; i++) {
+		int idle = i % IDLE_PERIOD >= IDLE_PERIOD - IDLE_RUN;
+
+		dst->rpm[i] = idle? 800 + (int16_t) (i % 7): src->rpm[i];
+		dst->spd[i] = idle? 0: src->spd[i];
+		dst->brk[i] = idle? 0: src->brk[i];
+	}
+}
+
+
+static int loadStream(stream_t *s, const char *path) {
+	FILE *f = fopen(path, "rb");
+	unsigned char b[6];
+	long size;
+
+	if (f == NULL)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (size < 6 || !allocStream(s, "recorded", size / 6)) {
+		fclose(f);
+		return 0;
+	}
+
+	for (size_t i = 0; i < s->n && fread(b, 1, 6, f) == 6; i++) {
+		s->rpm[i] = (int16_t) (b[0] | (b[1] << 8));
+		s->spd[i] = (int16_t) (b[2] | (b[3] << 8));
+		s->brk[i] = (int16_t) (b[4] | (b[5] << 8));
+	}
+	fclose(f);
+	return 1;
+}
+
+
+static void printResult(const char *name, const char *path, const char *stream, long window, double samples, double seconds) {
+	double ns = seconds*1e9 / samples;
+
+	printf("%s\n    {\"name\": \"%s\", \"path\": \"%s\", \"stream\": \"%s\", \"window\": %ld, "
+		"\"samples\": %.0f, \"ns_per_sample\": %.3f, \"samples_per_s\": %.0f}",
+		first_result? "": ",", name, path, stream, window, samples, ns, 1e9 / ns);
+	first_result = 0;
+}
+
+
+static void runScalar(wear_ctx_t *ctx, const stream_t *s, size_t window) {
+	unsigned char data[2];
+	size_t count = 0;
+
+	for (size_t i = 0; i < s->n; i++) {
+		accumulateWearCtx(ctx, s->rpm[i], s->spd[i], s->brk[i]);
+		if (++count == window) {
+			wearDataCtx(ctx, data);
+			sink = data[0];
+			resetWearCtx(ctx, 4);
+			count = 0;
+		}
+	}
+}
+
+
+static void runBatch(wear_ctx_t *ctx, const stream_t *s, size_t window) {
+	unsigned char data[2];
+	size_t i, k;
+
+	for (i = 0; i < s->n; i += k) {
+		k = (s->n - i < window)? s->n - i: window;
+		accumulateWearBatch(ctx, s->rpm + i, s->spd + i, s->brk + i, k);
+		if (k == window) {
+			wearDataCtx(ctx, data);
+			sink = data[0];
+			resetWearCtx(ctx, 4);
+		}
+	}
+}
+
+
+static void runTrip(wear_ctx_t *ctx, const stream_t *s, size_t window) {
+	wear_trip_t trip;
+	unsigned char data[2];
+	size_t i, k, end;
+	char ev;
+
+	initWearTrip(&trip, ctx, 600);
+	for (i = 0; i < s->n; i = end) {
+		k = (s->n - i < window)? s->n - i: window;
+		for (end = i + k; i < end; )	//para em cada fronteira de viagem
+			i += accumulateWearTripBatch(&trip, s->rpm + i, s->spd + i, s->brk + i, end - i, &ev);
+		if (k == window) {
+			wearDataCtx(ctx, data);
+			sink = data[0];
+			resetWearCtx(ctx, 4);
+		}
+	}
+}
+
+
+static void benchStream(const stream_t *s) {
+	static const size_t windows[] = {200, 1024, 65536};
+	void (*paths[])(wear_ctx_t *, const stream_t *, size_t) = {runScalar, runBatch, runTrip};
+	static const char *path_names[] = {"scalar", "batch", "trip"};
+	wear_ctx_t ctx;
+
+	for (int w = 0; w < 3; w++) {
+		for (int p = 0; p < 3; p++) {
+			double start, elapsed;
+			long reps = 0;
+
+			initWear(&ctx);
+			paths[p](&ctx, s, windows[w]);	//aquece caches
+			start = now();
+			do {
+				paths[p](&ctx, s, windows[w]);
+				reps++;
+				elapsed = now() - start;
+			} while (elapsed < MIN_SECONDS);
+
+			printResult("accumulateWear", path_names[p], s->name, (long) windows[w], (double) reps*s->n, elapsed);
+		}
+	}
+}
+
+
+static void benchComponents(const stream_t *s) {	//janela de 1024, aceleracoes derivadas do fluxo
+	int16_t *accel_long = (int16_t *) malloc(s->n*sizeof(int16_t));
+	int16_t *accel_lat = (int16_t *) malloc(s->n*sizeof(int16_t));
+	unsigned long seed = 54321;
+	unsigned char data[WEAR_COMP_BYTES];
+	wear_batch_t b;
+	wear_comp_t comp;
+	double start, elapsed;
+	long reps = 0;
+
+	if (accel_long == NULL || accel_lat == NULL) {
+		free(accel_long);
+		free(accel_lat);
+		return;
+	}
+	for (size_t i = 0; i < s->n; i++) {
+		int a = (i > 0)? (s->spd[i] - s->spd[i - 1])*278: 0;	//km/h por leitura de 100 ms em cm/s^2
+
+		seed = seed*1103515245 + 12345;
+		accel_long[i] = (int16_t) ((a > 32767)? 32767: (a < -32768)? -32768: a);
+		accel_lat[i] = (int16_t) ((seed >> 16) % 1001) - 500;
+	}
+
+	initWearComponents(&comp);
+	memset(&b, 0, sizeof(b));
+	start = now();
+	do {
+		for (size_t i = 0; i < s->n; i += 1024) {
+			size_t k = (s->n - i < 1024)? s->n - i: 1024;
+
+			b.rpm = s->rpm + i;
+			b.spd = s->spd + i;
+			b.brk = s->brk + i;
+			b.accel_long = accel_long + i;
+			b.accel_lat = accel_lat + i;
+			accumulateWearComponents(&comp, &b, k);
+			wearDataComponents(&comp, data);
+			sink = data[0];
+			resetWearComponents(&comp);
+		}
+		reps++;
+		elapsed = now() - start;
+	} while (elapsed < MIN_SECONDS);
+
+	printResult("accumulateWearComponents", "batch", s->name, 1024, (double) reps*s->n, elapsed);
+	free(accel_long);
+	free(accel_lat);
+}
+
+
+static void benchFunctions(const stream_t *s) {	//custo por chamada das funcoes internas, janela de 1024
+	wear_ctx_t ctx;
+	char bits[] = {2, 2}, param[2];
+	char weight[] = {0, 1, 5, 8};
+	double start, elapsed;
+	long calls;
+	unsigned acc;
+
+	initWear(&ctx);
+	for (size_t i = 0; i < 1024 && i < s->n; i++)
+		accumulateWearCtx(&ctx, s->rpm[i], s->spd[i], s->brk[i]);
+
+#define BENCH_LOOP(label, body) \
+	acc = 0; calls = 0; start = now(); \
+	do { \
+		for (size_t i = 0; i < s->n; i++) { body; } \
+		calls += s->n; \
+		elapsed = now() - start; \
+	} while (elapsed < MIN_SECONDS); \
+	sink = (unsigned char) acc; \
+	printResult(label, "scalar", s->name, 0, (double) calls, elapsed)
+
+	BENCH_LOOP("discretize", acc += discretize(s->rpm[i], RPM_THRESHOLD, 3));
+	BENCH_LOOP("rate", acc += rate(s->brk[i ? i - 1 : 0], s->brk[i], BRK_RATE_THRESHOLD));
+	BENCH_LOOP("verifyWear", param[0] = i & 3; param[1] = (i >> 2) & 3; acc += verifyWear(param, bits, 2, BRAKE_WEAR));
+	BENCH_LOOP("average", ctx.hist.brake[i & 3] ^= 1; acc += average(ctx.hist.brake, weight));
+	BENCH_LOOP("percent", ctx.hist.rpm[i & 3] ^= 1; acc += percent(ctx.hist.rpm, i & 3, 4));
+	BENCH_LOOP("wearData", unsigned char d[2]; ctx.hist.clutch[i & 3] ^= 1; wearDataCtx(&ctx, d); acc += d[0]);
+
+#undef BENCH_LOOP
+}
+
+
+int main(int argc, char *argv[]) {
+	stream_t synth, idle, recorded;
+	int has_recorded = 0;
+
+	if (!allocStream(&synth, "synthetic", SYNTH_SAMPLES) || !allocStream(&idle, "synthetic-idle", SYNTH_SAMPLES)) {
+		fprintf(stderr, "Sem memoria.\n");
+		return 1;
+	}
+	synthStream(&synth);
+	idleStream(&idle, &synth);
+
+	if (argc > 1) {
+		has_recorded = loadStream(&recorded, argv[1]);
+		if (!has_recorded) {
+			fprintf(stderr, "Nao foi possivel ler %s.\n", argv[1]);
+			return 1;
+		}
+	}
+
+	printf("{\n  \"simd\": \"%s\", \"acc_bits\": %d, \"lut\": %d,\n  \"results\": [",
+		SIMD_NAME, WEAR_ACC_BITS, WEAR_USE_LUT);
+	benchStream(&synth);
+	benchComponents(&synth);
+	benchStream(&idle);
+	if (has_recorded) {
+		benchStream(&recorded);
+		benchComponents(&recorded);
+	}
+	benchFunctions(&synth);
+	printf("\n  ]\n}\n");
+
+	return 0;
+}
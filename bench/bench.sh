@@ -0,0 +1,6 @@
+#!/bin/sh
+# compila e roda o benchmark do motor de desgaste (Linux)
+# uso: bench/bench.sh [fluxo.bin] > resultado.json
+cd "$(dirname "$0")/.." || exit 1
+gcc -O2 -march=native -I sketch -o bench/abrasion_bench bench/abrasion_bench.c sketch/*.c || exit 1
+./bench/abrasion_bench "$@"
@@ -0,0 +1,10 @@
+#!/bin/sh
+# compila e roda as verificacoes de wear_check.c e frame_check.cpp (Linux); sai com 1 se alguma falhar
+# uso: bench/check.sh [fluxo.bin]
+cd "$(dirname "$0")/.." || exit 1
+gcc -O2 -I sketch -o bench/wear_check bench/wear_check.c sketch/*.c || exit 1
+g++ -O2 -I ipc -o bench/frame_check bench/frame_check.cpp ipc/wearframe.cpp ipc/tcpclient.cpp || exit 1
+./bench/wear_check "$@"
+status=$?
+./bench/frame_check || status=1
+exit $status
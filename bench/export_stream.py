@@ -0,0 +1,26 @@
+# exporta os logs do config.json no formato lido por abrasion_bench:
+# int16 little-endian rpm, spd, brk por amostra
+# uso: python bench/export_stream.py saida.bin
+import json, sys
+import h5py
+import numpy as np
+
+def main():
+	config = json.loads(open("./config.json").read())
+	rpm_key, spd_key, brk_key = config["variables"]
+	out = open(sys.argv[1], "wb")
+
+	for name in config["log_names"]:
+		log = h5py.File(config["logs_path"] + name, 'r')
+		samples = np.empty((len(log[rpm_key]), 3), dtype='<i2')
+		samples[:, 0] = log[rpm_key]
+		samples[:, 1] = log[spd_key]
+		samples[:, 2] = np.clip(log[brk_key], 0, 4096)	#mesmo ajuste de tame_dset
+		samples.tofile(out)
+		print("%s: %d samples" %(name, len(samples)))
+
+	out.close()
+	return 0
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,264 @@
+/*
+    Verificacao do protocolo de amostras (ipc/wearframe): lotes montados como
+    o tcpServer.frameBytes monta, com todas as mascaras e tamanhos de 0 a
+    FRAME_MAX, decodificados e comparados com a origem; cabecalhos invalidos;
+    hellos e acks; e um hello de veiculo seguido de lotes, cortados em pedacos
+    aleatorios num socketpair e lidos pelo anel de recepcao na ordem do
+    wear_server. Imprime uma linha por verificacao e termina com 1 se alguma
+    falhou.
+
+    uso: frame_check
+*/
+#include <stdio.h>
+#include "tcpclient.hpp"
+#include "wearframe.hpp"
+
+const int SAMPLES = 4*FRAME_MAX;
+const int SPLIT_RING = 16384;   //o RING_SIZE do wear_server
+const int SPLIT_PIECE = 3000;   //bytes por escrita, no maximo
+
+static int failures = 0;
+static unsigned long seed = 12345;
+static short source[FIELDS][SAMPLES];   //rpm, velocidade e freio
+static const short *src[FIELDS] = {source[0], source[1], source[2]};
+
+static void report(const char *check, bool ok)
+{
+    printf("%-28s %s\n", check, ok? "ok": "FALHOU");
+    failures += !ok;
+}
+
+static short nextSample()  //cobre o int16 inteiro, negativos inclusive
+{
+    seed = seed*1103515245 + 12345;
+    return (short) (seed >> 16);
+}
+
+static void putHeader(unsigned char *out, int version, int mask, int count, uint32_t length)
+{
+    out[0] = (unsigned char) version;
+    out[1] = (unsigned char) mask;
+    out[2] = (unsigned char) (count >> 8);
+    out[3] = (unsigned char) count;
+    out[4] = (unsigned char) (length >> 24);
+    out[5] = (unsigned char) (length >> 16);
+    out[6] = (unsigned char) (length >> 8);
+    out[7] = (unsigned char) length;
+}
+
+static int encodeFrame(unsigned char *out, int mask, const short *src[FIELDS], int from, int count)   //bytes escritos
+{
+    unsigned char *p = out + FRAME_HEADER;
+
+    for(int k = 0; k < FIELDS; k++)
+    {
+        if(!(mask & (1 << k)))
+            continue;
+        for(int i = 0; i < count; i++)
+        {
+            *p++ = (unsigned char) ((unsigned short) src[k][from + i] >> 8);
+            *p++ = (unsigned char) src[k][from + i];
+        }
+    }
+    putHeader(out, PROTOCOL_VERSION, mask, count, (uint32_t) (p - out - FRAME_HEADER));
+    return (int) (p - out);
+}
+
+static void checkFrames()
+{
+    static unsigned char buf[FRAME_HEADER + 2*FIELDS*FRAME_MAX];
+    static int16_t out[FIELDS][FRAME_MAX];
+    static const int counts[] = {0, 1, 37, FRAME_MAX};
+    frame_t f;
+    bool ok = true;
+    int from = 0;
+
+    for(int mask = 0; mask < (1 << FIELDS); mask++)
+    {
+        for(size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); c++)
+        {
+            int count = counts[c];
+
+            from = (from + 997) % (SAMPLES - FRAME_MAX);
+            encodeFrame(buf, mask, src, from, count);
+            ok &= readFrame(&f, buf) && f.count == count && f.mask == mask;
+            decodeFrame(&f, buf + FRAME_HEADER, out[0], out[1], out[2]);
+            for(int i = 0; i < count; i++)
+            {
+                short one[FIELDS];
+
+                decode(&f, buf + FRAME_HEADER, i, &one[0], &one[1], &one[2]);
+                for(int k = 0; k < FIELDS; k++)    //campo ausente vale 0
+                {
+                    short expect = (mask & (1 << k))? src[k][from + i]: 0;
+
+                    ok &= out[k][i] == expect && one[k] == expect;
+                }
+            }
+        }
+    }
+    report("frame round trip", ok);
+
+    //cada cabecalho invalido e recusado
+    encodeFrame(buf, 7, src, 0, 16);
+    ok = readFrame(&f, buf);
+    putHeader(buf, PROTOCOL_VERSION + 1, 7, 16, 2*16*3);
+    ok &= !readFrame(&f, buf);
+    putHeader(buf, PROTOCOL_VERSION, 7 | (1 << FIELDS), 16, 2*16*3);
+    ok &= !readFrame(&f, buf);
+    putHeader(buf, PROTOCOL_VERSION, 7, FRAME_MAX + 1, 2*(FRAME_MAX + 1)*3);
+    ok &= !readFrame(&f, buf);
+    putHeader(buf, PROTOCOL_VERSION, 7, 16, 2*16*3 - 2);
+    ok &= !readFrame(&f, buf);
+    putHeader(buf, PROTOCOL_VERSION, 3, 16, 2*16*3);   //tamanho de 3 campos com 2 na mascara
+    ok &= !readFrame(&f, buf);
+    report("frame reject", ok);
+}
+
+static void checkHello()
+{
+    unsigned char msg[HELLO_SIZE];
+    wear_ack_t a, b;
+    bool ok;
+
+    initAck(&a, 300, 20);
+    writeHello(msg, &a);
+    ok = readHello(&b, msg) && b.ack_every == 300 && b.ack_ms == 20 && b.seq == 0 && b.acked == 0;
+    msg[2] = PROTOCOL_VERSION + 1;
+    ok &= !readHello(&b, msg);
+    report("hello round trip", ok);
+}
+
+static void checkVehicleHello()
+{
+    unsigned char msg[HELLO_SIZE];
+    wear_ack_t a;
+    uint32_t id = 0;
+    bool ok;
+
+    writeVehicleHello(msg, 0xA1B2C3D4);
+    ok = readVehicleHello(msg, &id) && id == 0xA1B2C3D4;
+    ok &= !readHello(&a, msg);     //um lado nao aceita o hello do outro
+    initAck(&a, 256, 20);
+    writeHello(msg, &a);
+    ok &= !readVehicleHello(msg, &id);
+    report("vehicle hello round trip", ok);
+}
+
+static bool consume(recv_ring_t *r, bool *hello, bool *framed, frame_t *f, uint32_t *id, int16_t *got[FIELDS], int *n)    //false se algo nao confere
+{
+    unsigned char *msg;
+
+    while((msg = (unsigned char *) recData(r, !*hello? HELLO_SIZE: *framed? f->length: FRAME_HEADER)) != NULL)
+    {
+        if(!*hello)
+        {
+            if(!(*hello = readVehicleHello(msg, id)))
+                return false;
+        }
+        else if(!*framed)
+        {
+            if(!(*framed = readFrame(f, msg)) || *n + f->count > SAMPLES)
+                return false;
+        }
+        else
+        {
+            *framed = false;
+            decodeFrame(f, msg, got[0] + *n, got[1] + *n, got[2] + *n);
+            *n += f->count;
+        }
+    }
+    return true;
+}
+
+static void checkSplit()   //hello e lotes em pedacos aleatorios, lidos como o serveConn le
+{
+    static unsigned char stream[HELLO_SIZE + SAMPLES*(FRAME_HEADER + 2*FIELDS)];
+    alignas(RECV_RING_ALIGN) static char ring_buf[SPLIT_RING];
+    static int16_t out[FIELDS][SAMPLES];
+    int16_t *got[FIELDS] = {out[0], out[1], out[2]};
+    recv_ring_t ring;
+    frame_t f;
+    uint32_t id = 0;
+    int sv[2], len = HELLO_SIZE, sent = 0, taken = 0, n = 0;
+    bool ok = true, hello = false, framed = false;
+
+    writeVehicleHello(stream, 42);
+    for(int from = 0; from < SAMPLES; )
+    {
+        int count = 1 + (unsigned short) nextSample() % FRAME_MAX;
+
+        count = (count > SAMPLES - from)? SAMPLES - from: count;
+        len += encodeFrame(stream + len, 7, src, from, count);
+        from += count;
+    }
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        report("frames split through ring", false);
+        return;
+    }
+    initRecvRing(&ring, ring_buf, SPLIT_RING);
+    while(ok && sent < len)
+    {
+        int piece = 1 + (unsigned short) nextSample() % SPLIT_PIECE;
+
+        piece = (piece > len - sent)? len - sent: piece;
+        if(send(sv[0], (char *) stream + sent, piece, 0) != piece)
+            break;
+        sent += piece;
+        while(ok && taken < sent)
+        {
+            int r = recvInto(&ring, sv[1]);
+
+            ok = r > 0 && consume(&ring, &hello, &framed, &f, &id, got, &n);
+            taken += r;
+        }
+    }
+    closesocket(sv[0]);
+    closesocket(sv[1]);
+
+    ok &= sent == len && id == 42 && n == SAMPLES && !framed && ring.len == 0;
+    for(int k = 0; k < FIELDS && ok; k++)
+        ok = memcmp(out[k], src[k], sizeof(out[k])) == 0;
+    report("frames split through ring", ok);
+}
+
+static void checkAck()
+{
+    unsigned char msg[ACK_SIZE];
+    wear_ack_t a;
+    bool ok;
+
+    initAck(&a, 4, 0);     //sem prazo: so por contagem ou fila vazia
+    ok = ackMessage(&a, true, msg) == 0;   //nada pendente
+    a.seq = 3;
+    ok &= ackMessage(&a, false, msg) == 0;
+    a.seq = 4;
+    ok &= ackMessage(&a, false, msg) == ACK_SIZE && msg[0] == 'A'
+        && msg[1] == 0 && msg[2] == 0 && msg[3] == 0 && msg[4] == 4;
+    ok &= ackMessage(&a, false, msg) == 0 && a.acked == 4;
+    a.seq = 5;
+    ok &= ackMessage(&a, false, msg) == 0;
+    ok &= ackMessage(&a, true, msg) == ACK_SIZE && msg[4] == 5;   //fila vazia confirma o resto
+    a.seq = 0x01020304 + 5UL;
+    ok &= ackMessage(&a, false, msg) == ACK_SIZE && msg[1] == 1 && msg[2] == 2 && msg[3] == 3 && msg[4] == 9;
+    report("ack", ok);
+}
+
+int main()
+{
+    for(int i = 0; i < SAMPLES; i++)
+    {
+        for(int k = 0; k < FIELDS; k++)
+            source[k][i] = nextSample();
+    }
+
+    checkFrames();
+    checkHello();
+    checkVehicleHello();
+    checkAck();
+    checkSplit();
+
+    return failures > 0;
+}
@@ -0,0 +1,737 @@
+/*
+ * Verificacao dos modulos sobre o motor de desgaste contra o caminho por
+ * amostra (accumulateWearCtx): tabelas de classificacao (wear_lut.h), lotes
+ * vetoriais (accumulateWearBatch), perfis (checkWearProfile, foldWearRaw,
+ * wear_profile.h e a troca entre janelas), janela deslizante (wear_slide.h), agregacao
+ * por escala de tempo (wear_rollup.h), sketches de quantis (wear_quantile.h),
+ * janelas de varios tamanhos (wear_multi.h), snapshots (wear_snapshot.h) e
+ * viagens (wear_trip.h), num
+ * fluxo sintetico, no mesmo fluxo com paradas longas em marcha lenta e
+ * opcionalmente num fluxo gravado (mesmo formato do abrasion_bench). Imprime
+ * uma linha por verificacao e termina com 1 se alguma falhou.
+ *
+ * uso: wear_check [fluxo.bin]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "abrasion.h"
+#include "wear_lut.h"
+#include "wear_profile.h"
+#include "wear_slide.h"
+#include "wear_rollup.h"
+#include "wear_quantile.h"
+#include "wear_multi.h"
+#include "wear_snapshot.h"
+#include "wear_trip.h"
+
+#define SYNTH_SAMPLES	(1 << 17)
+#define SLIDE_LEN		200
+#define SLIDE_EVERY		997		//amostras entre comparacoes, a referencia custa SLIDE_LEN
+#define ROLLUP_WINDOW	200		//amostras de 100 ms: o minuto fecha a cada 3 janelas
+#define ROLLUP_LONG		4096	//409,6 s: cobre mais de 6 minutos
+#define MULTI_K			3
+#define MULTI_CHUNK		1000	//lotes que nao caem nas bordas das janelas
+#define IDLE_PERIOD		2000	//a cada IDLE_PERIOD amostras, as ultimas IDLE_RUN em marcha lenta
+#define IDLE_RUN		700
+#define QUANT_WINDOW	1024
+#define QUANT_PASSES	8		//o agregado passa de 65535 amostras por bucket
+#define TRIP_STOP		600
+#define TRIP_WINDOW		1024
+
+typedef struct {
+	const char *name;
+	int16_t *rpm, *spd, *brk;
+	size_t n;
+} stream_t;
+
+static int failures = 0;
+
+
+static void report(const char *check, const stream_t *s, int ok) {
+	printf("%-28s %-10s %s\n", check, s->name, ok? "ok": "FALHOU");
+	failures += !ok;
+}
+
+
+static int allocStream(stream_t *s, const char *name, size_t n) {
+	s->name = name;
+	s->n = n;
+	s->rpm = (int16_t *) malloc(n*sizeof(int16_t));
+	s->spd = (int16_t *) malloc(n*sizeof(int16_t));
+	s->brk = (int16_t *) malloc(n*sizeof(int16_t));
+	return s->rpm != NULL && s->spd != NULL && s->brk != NULL;
+}
+
+
+static void synthStream(stream_t *s) {	//o mesmo passeio aleatorio do abrasion_bench
+	unsigned long seed = 12345;
+	int rpm = 800, spd = 0, brk = 0;
+	static const int brk_step[] = {0, 0, 0, -70, 70, 20, -20, 300, -300};
+
+	for (size_t i = 0; i < s->n; i++) {
+		seed = seed*1103515245 + 12345;
+		rpm += (int) ((seed >> 16) % 121) - 60;
+		spd += (int) ((seed >> 8) % 5) - 2;
+		brk += brk_step[(seed >> 24) % 9];
+		rpm = (rpm < 0)? 0: (rpm > 8000)? 8000: rpm;
+		spd = (spd < 0)? 0: (spd > 40)? 40: spd;
+		brk = (brk < 0)? 0: (brk > 4095)? 4095: brk;
+		s->rpm[i] = rpm;
+		s->spd[i] = spd;
+		s->brk[i] = brk;
+	}
+}
+
+
+static void idleStream(stream_t *dst, const stream_t *src) {	//o mesmo do abrasion_bench
+	for (size_t i = 0; i < src->n; i++) {
+		int idle = i % IDLE_PERIOD >= IDLE_PERIOD - IDLE_RUN;
+
+		dst->rpm[i] = idle? 800 + (int16_t) (i % 7): src->rpm[i];
+		dst->spd[i] = idle? 0: src->spd[i];
+		dst->brk[i] = idle? 0: src->brk[i];
+	}
+}
+
+
+static int loadStream(stream_t *s, const char *path) {
+	FILE *f = fopen(path, "rb");
+	unsigned char b[6];
+	long size;
+
+	if (f == NULL)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (size < 6 || !allocStream(s, "recorded", size / 6)) {
+		fclose(f);
+		return 0;
+	}
+
+	for (size_t i = 0; i < s->n && fread(b, 1, 6, f) == 6; i++) {
+		s->rpm[i] = (int16_t) (b[0] | (b[1] << 8));
+		s->spd[i] = (int16_t) (b[2] | (b[3] << 8));
+		s->brk[i] = (int16_t) (b[4] | (b[5] << 8));
+	}
+	fclose(f);
+	return 1;
+}
+
+
+// contexto por amostra sobre [from, to), com as variacoes a partir da amostra
+// from - 1; p NULL usa o perfil padrao
+static void scalarCtx(const stream_t *s, size_t from, size_t to, const wear_profile_t *p, wear_ctx_t *ctx) {
+	initWear(ctx);
+	setWearProfile(ctx, p);
+	if (from > 0)
+		classifyWear(ctx, s->rpm[from - 1], s->spd[from - 1], s->brk[from - 1]);
+	for (size_t i = from; i < to; i++)
+		accumulateWearCtx(ctx, s->rpm[i], s->spd[i], s->brk[i]);
+}
+
+
+static void scalarHist(const stream_t *s, size_t from, size_t to, wear_hist_t *out) {
+	wear_ctx_t ctx;
+
+	scalarCtx(s, from, to, NULL, &ctx);
+	*out = ctx.hist;
+}
+
+
+static const wear_profile_t *otherProfile(void) {	//valido, com limiares de rpm, pesos e uma tabela diferentes do padrao
+	static const char brake_weight[4] = {8, 5, 1, 0};
+	static wear_profile_t p;
+
+	p = WEAR_DEFAULT_PROFILE;
+	for (int c = 0; c < 3; c++)
+		p.rpm[c] -= 300;
+	memcpy(p.brake_weight, brake_weight, sizeof(brake_weight));
+	p.brake_wear[BRAKE_WEAR_LEN - 1] = 0;
+	return &p;
+}
+
+
+static int sameHist(const wear_hist_t *a, const wear_hist_t *b) {
+	return memcmp(a, b, sizeof(wear_hist_t)) == 0;
+}
+
+
+static void checkLut(const stream_t *s) {	//tabelas contra a busca linear em todo o int16 e no fluxo
+	wear_profile_t copy = WEAR_DEFAULT_PROFILE;	//outro endereco: classifica por discretize
+	wear_ctx_t lut, linear;
+	unsigned char a[2], b[2];
+	int ok = 1;
+
+	for (long v = -32768; v <= 32767; v++) {
+		ok &= lutClass(RPM_LUT, (int) v, RPM_T0, RPM_LUT_SIZE) == discretize((short) v, RPM_THRESHOLD, 3);
+		ok &= lutClass(SPD_LUT, (int) v, SPD_T0, SPD_LUT_SIZE) == discretize((short) v, SPD_THRESHOLD, 3);
+		ok &= lutClass(RPM_RATE_LUT, (int) v, RPM_RATE_T0, RPM_RATE_LUT_SIZE) == rate(0, (short) v, RPM_RATE_THRESHOLD);
+		ok &= lutClass(BRK_RATE_LUT, (int) v, BRK_RATE_T0, BRK_RATE_LUT_SIZE) == rate(0, (short) v, BRK_RATE_THRESHOLD);
+	}
+	report("lut vs discretize", s, ok);
+
+	ok = 1;	//*_INDEX contra a montagem bit a bit de verifyWear, em todas as combinacoes
+	for (int hi = 0; hi < 4; hi++) {
+		for (int lo = 0; lo < 4; lo++) {
+			char param[2] = {(char) hi, (char) lo};
+			char brake_bits[2] = {BRAKE_SPD_BITS, BRAKE_RATE_BITS}, engine_bits[2] = {ENGINE_RPM_BITS, ENGINE_TIME_BITS};
+			char clutch_bits[2] = {CLUTCH_RATE_BITS, CLUTCH_BRK_BITS};
+
+			ok &= BRAKE_WEAR[BRAKE_INDEX(hi, lo)] == verifyWear(param, brake_bits, 2, BRAKE_WEAR);
+			ok &= ENGINE_WEAR[ENGINE_INDEX(hi, lo)] == verifyWear(param, engine_bits, 2, ENGINE_WEAR);
+			if (lo < 2)
+				ok &= CLUTCH_WEAR[CLUTCH_INDEX(hi, lo)] == verifyWear(param, clutch_bits, 2, CLUTCH_WEAR);
+		}
+	}
+	report("table index vs verifyWear", s, ok);
+
+	scalarCtx(s, 0, s->n, NULL, &lut);
+	scalarCtx(s, 0, s->n, &copy, &linear);
+	wearDataCtx(&lut, a);
+	wearDataCtx(&linear, b);
+	report("lut ctx vs linear ctx", s, sameHist(&lut.hist, &linear.hist) && a[0] == b[0]);
+}
+
+
+static void checkBatch(const stream_t *s) {	//lotes de varios tamanhos, nos dois perfis, contra a passada por amostra
+	static const size_t chunks[] = {1, 7, 33, 1000, 0};	//0: o fluxo inteiro num lote
+	const wear_profile_t *profiles[2] = {NULL, otherProfile()};
+	wear_ctx_t ref, batch;
+	int ok = 1;
+
+	for (int k = 0; k < 2; k++) {
+		scalarCtx(s, 0, s->n, profiles[k], &ref);
+		for (size_t c = 0; c < sizeof(chunks)/sizeof(chunks[0]); c++) {
+			size_t step = chunks[c]? chunks[c]: s->n;
+
+			initWear(&batch);
+			setWearProfile(&batch, profiles[k]);
+			accumulateWearBatch(&batch, s->rpm, s->spd, s->brk, 0);
+			for (size_t i = 0; i < s->n; i += step) {
+				size_t len = (s->n - i < step)? s->n - i: step;
+
+				accumulateWearBatch(&batch, s->rpm + i, s->spd + i, s->brk + i, len);
+			}
+			ok &= sameHist(&ref.hist, &batch.hist) && ref.last_rpm == batch.last_rpm && ref.last_brk == batch.last_brk;
+		}
+	}
+	report("batch vs scalar", s, ok);
+}
+
+
+static void checkProfile(const stream_t *s) {
+	wear_profile_t bad, tables = *otherProfile();
+	wear_ctx_t ref, ctx;
+	wear_raw_t raw;
+	wear_hist_t hist;
+	unsigned char a[2], b[2];
+	int ok = checkWearProfile(&WEAR_DEFAULT_PROFILE) && checkWearProfile(otherProfile());
+
+	bad = WEAR_DEFAULT_PROFILE;
+	bad.rpm[1] = bad.rpm[0];	//limiares nao crescentes
+	ok &= !checkWearProfile(&bad);
+	bad = WEAR_DEFAULT_PROFILE;
+	bad.brake_weight[2] = -1;
+	ok &= !checkWearProfile(&bad);
+	bad = WEAR_DEFAULT_PROFILE;
+	bad.clutch_weight[3] = 8*sizeof(wear_wide_t);	//deslocamento maior que o acumulador
+	ok &= !checkWearProfile(&bad);
+	bad = WEAR_DEFAULT_PROFILE;
+	bad.engine_wear[5] = 4;
+	ok &= !checkWearProfile(&bad);
+	bad = WEAR_DEFAULT_PROFILE;
+	bad.clutch_wear[1] = -1;
+	ok &= !checkWearProfile(&bad);
+	report("profile reject", s, ok);
+
+	// contagem bruta com os limiares de otherProfile, dobrada com outras tabelas e pesos
+	tables.brake_wear[0] = 3;
+	tables.clutch_wear[CLUTCH_WEAR_LEN - 1] = 2;
+	tables.rpm_weight[3] = 2;
+	scalarCtx(s, 0, s->n, &tables, &ref);
+	initWear(&ctx);
+	setWearProfile(&ctx, otherProfile());
+	memset(&raw, 0, sizeof(raw));
+	memset(&hist, 0, sizeof(hist));
+	accumulateWearRaw(&ctx, s->rpm, s->spd, s->brk, s->n, &raw);
+	foldWearRaw(&raw, &tables, &hist);
+	wearDataCtx(&ref, a);
+	wearDataProfile(&hist, &tables, b);
+	report("raw fold vs scalar", s, sameHist(&hist, &ref.hist) && a[0] == b[0]);
+}
+
+
+static void setCrc(unsigned char *buf, size_t crc_at) {	//recalcula o CRC-16 de um buffer alterado
+	unsigned short crc = wearCrc16(buf, crc_at);
+
+	buf[crc_at] = (unsigned char) crc;
+	buf[crc_at + 1] = (unsigned char) (crc >> 8);
+}
+
+
+static void checkProfileSwap(const stream_t *s) {
+	unsigned char buf[WEAR_PROFILE_SIZE], again[WEAR_PROFILE_SIZE], bad[WEAR_PROFILE_SIZE];
+	wear_profile_t q, before;
+	wear_ctx_t ref, ctx;
+	size_t half = s->n / 2;
+	int ok;
+
+	wearProfileEncode(otherProfile(), buf);
+	memset(&q, 0, sizeof(q));
+	ok = wearProfileDecode(&q, buf);
+	wearProfileEncode(&q, again);
+	ok &= memcmp(buf, again, sizeof(buf)) == 0 && wearProfileId(&q) == wearProfileId(otherProfile());
+	ok &= wearProfileId(&q) != wearProfileId(&WEAR_DEFAULT_PROFILE);
+	report("profile round trip", s, ok);
+
+	// cada buffer ruim e recusado e deixa o perfil como estava
+	before = q;
+	memcpy(bad, buf, sizeof(bad));
+	bad[10] ^= 0x01;
+	ok = !wearProfileDecode(&q, bad);
+	memcpy(bad, buf, sizeof(bad));
+	bad[2] = WEAR_PROFILE_VERSION + 1;
+	setCrc(bad, WEAR_PROFILE_SIZE - 2);
+	ok &= !wearProfileDecode(&q, bad);
+	memcpy(bad, buf, sizeof(bad));
+	bad[28 + 4 + 2] = 0xFF;	//brake_weight[2] = -1, com CRC valido
+	setCrc(bad, WEAR_PROFILE_SIZE - 2);
+	ok &= !wearProfileDecode(&q, bad);
+	report("profile decode reject", s, ok && memcmp(&q, &before, sizeof(q)) == 0);
+
+	// pedido no meio do fluxo: nada muda ate a troca, e o ultimo pedido vence
+	scalarCtx(s, 0, half, NULL, &ref);
+	initWear(&ctx);
+	ok = !swapWearProfile(&ctx);
+	for (size_t i = 0; i < half; i++) {
+		if (i == half / 2) {
+			requestWearProfile(&ctx, otherProfile());
+			requestWearProfile(&ctx, &q);
+		}
+		accumulateWearCtx(&ctx, s->rpm[i], s->spd[i], s->brk[i]);
+	}
+	ok &= sameHist(&ctx.hist, &ref.hist) && ctx.profile == NULL && ctx.next_profile == &q;
+	ok &= swapWearProfile(&ctx) && ctx.profile == &q && ctx.next_profile == NULL && !swapWearProfile(&ctx);
+	resetWearCtx(&ctx, 4);
+	scalarCtx(s, half, s->n, &q, &ref);
+	for (size_t i = half; i < s->n; i++)
+		accumulateWearCtx(&ctx, s->rpm[i], s->spd[i], s->brk[i]);
+	report("profile swap", s, ok && sameHist(&ctx.hist, &ref.hist));
+}
+
+
+static void checkSlide(const stream_t *s) {
+	static unsigned char ring[SLIDE_LEN];
+	unsigned char a[2], b[2];
+	wear_slide_t slide;
+	wear_hist_t ref;
+	int ok = 1;
+
+	initWearSlide(&slide, ring, SLIDE_LEN);
+	for (size_t i = 0; i < s->n; i++) {
+		accumulateWearSlide(&slide, s->rpm[i], s->spd[i], s->brk[i]);
+		if ((i + 1) % SLIDE_EVERY != 0 && i + 1 != s->n)
+			continue;
+		scalarHist(s, (i + 1 > SLIDE_LEN)? i + 1 - SLIDE_LEN: 0, i + 1, &ref);
+		wearDataSlide(&slide, a);
+		wearDataHist(&ref, b);
+		ok &= memcmp(&slide.ctx.hist, &ref, sizeof(ref)) == 0 && a[0] == b[0];
+	}
+	report("slide vs scalar", s, ok);
+
+	ok = !initWearSlide(&slide, ring, 0) && !initWearSlide(&slide, NULL, SLIDE_LEN);
+	accumulateWearSlide(&slide, s->rpm[0], s->spd[0], s->brk[0]);	//sem anel: ignorada
+	report("slide len 0", s, ok && slide.fill == 0);
+}
+
+
+static void checkRollup(const stream_t *s) {
+	const wear_profile_t *p = otherProfile();
+	wear_rollup_t r;
+	wear_ctx_t ctx;
+	wear_hist_t ref;
+	size_t windows = s->n / ROLLUP_WINDOW, trip_start = 0, trip_end = windows / 2;
+	int ok = 1;
+
+	initWearRollup(&r);
+	initWear(&ctx);
+	for (size_t w = 0; w < windows; w++) {
+		for (size_t i = w*ROLLUP_WINDOW; i < (w + 1)*ROLLUP_WINDOW; i++)
+			accumulateWearCtx(&ctx, s->rpm[i], s->spd[i], s->brk[i]);
+		wearRollupAdd(&r, &ctx.hist, ROLLUP_WINDOW*100UL);
+		resetWearCtx(&ctx, 4);
+
+		if ((w + 1) % 3 == 0) {	//o minuto que acabou de fechar
+			scalarHist(s, (w - 2)*ROLLUP_WINDOW, (w + 1)*ROLLUP_WINDOW, &ref);
+			ok &= sameHist(wearRollupHist(&r, WEAR_MINUTE, 1), &ref);
+		}
+		if (w + 1 == trip_end) {
+			wearRollupEndTrip(&r);
+			scalarHist(s, trip_start, trip_end*ROLLUP_WINDOW, &ref);
+			ok &= sameHist(wearRollupHist(&r, WEAR_TRIP, 1), &ref);
+		}
+	}
+	scalarHist(s, 0, windows*ROLLUP_WINDOW, &ref);
+	ok &= sameHist(wearRollupHist(&r, WEAR_LIFETIME, 0), &ref);
+	ok &= r.periods[WEAR_MINUTE] == windows / 3 && r.periods[WEAR_HOUR] == windows / 180;
+	report("rollup vs scalar", s, ok);
+
+	//janelas mais longas que o minuto, com outro perfil: cada uma fecha o minuto
+	//inteira, periods conta todos os minutos cobertos e o byte usa o perfil
+	initWearRollup(&r);
+	ok = 1;
+	for (size_t w = 0; w < s->n / ROLLUP_LONG; w++) {
+		unsigned long ms = (w + 1)*ROLLUP_LONG*100UL;
+		unsigned char a[2], b[2];
+
+		scalarCtx(s, w*ROLLUP_LONG, (w + 1)*ROLLUP_LONG, p, &ctx);
+		wearRollupAdd(&r, &ctx.hist, ROLLUP_LONG*100UL);
+		wearDataRollup(&r, p, WEAR_MINUTE, 1, a);
+		wearDataCtx(&ctx, b);
+		ok &= sameHist(wearRollupHist(&r, WEAR_MINUTE, 1), &ctx.hist) && a[0] == b[0]
+			&& r.periods[WEAR_MINUTE] == ms / 60000 && r.periods[WEAR_HOUR] == ms / 3600000
+			&& r.elapsed_ms[WEAR_MINUTE] == ms % 60000;
+	}
+	report("rollup long windows", s, ok);
+}
+
+
+static void checkQuantile(const stream_t *s) {
+	wear_quant_t scalar, batch;
+	wear_ctx_t ctx;
+	wear_wide_t classes[4], exact[4] = {0, 0, 0, 0};
+	static const short rpm_t[] = {RPM_T0, RPM_T1, RPM_T2};
+	int ok;
+
+	initWearQuant(&scalar);
+	initWear(&ctx);
+	ctx.quant = &scalar;
+	for (size_t i = 0; i < s->n; i++)
+		accumulateWearCtx(&ctx, s->rpm[i], s->spd[i], s->brk[i]);
+
+	initWearQuant(&batch);
+	initWear(&ctx);
+	ctx.quant = &batch;
+	for (size_t i = 0; i < s->n; i += 1024)
+		accumulateWearBatch(&ctx, s->rpm + i, s->spd + i, s->brk + i, (s->n - i < 1024)? s->n - i: 1024);
+	report("quantile batch vs scalar", s, memcmp(&scalar, &batch, sizeof(scalar)) == 0);
+
+	//as classes do sketch so erram dentro do bucket de cada limiar
+	for (size_t i = 0; i < s->n; i++)
+		exact[(int) discretize(s->rpm[i], rpm_t, 3)]++;
+	qsketchClasses(&scalar.rpm, rpm_t, classes);
+	ok = qsketchTotal(&scalar.rpm) == (wear_wide_t) s->n;
+	for (int c = 0; c < 3; c++) {
+		wear_wide_t lo = qsketchRank(&scalar.rpm, (short) (rpm_t[c] - rpm_t[c]/QSKETCH_SUB - 1));
+		wear_wide_t hi = qsketchRank(&scalar.rpm, (short) (rpm_t[c] + rpm_t[c]/QSKETCH_SUB + 1));
+		wear_wide_t below = 0;
+
+		for (int k = 0; k <= c; k++)
+			below += exact[k];
+		ok &= below + 1 >= lo && below <= hi + 1;
+	}
+	report("quantile classes", s, ok && classes[0] + classes[1] + classes[2] + classes[3] == (wear_wide_t) s->n);
+}
+
+
+
+// janelas de QUANT_WINDOW amostras somadas num agregado largo, contra a soma
+// exata dos contadores; o agregado precisa passar do limite de 16 bits
+static void checkQuantileWide(const stream_t *s) {
+	static wear_quant_t window;
+	static wear_quant_wide_t agg;
+	static unsigned long long ref[QSKETCH_BUCKETS];
+	static const short rpm_t[] = {RPM_T0, RPM_T1, RPM_T2};
+	wear_wide_t classes[4];
+	wear_ctx_t ctx;
+	unsigned long long most = 0;
+	short p50;
+	int ok = 1;
+
+	memset(ref, 0, sizeof(ref));
+	initWearQuantWide(&agg);
+	for (int pass = 0; pass < QUANT_PASSES; pass++) {
+		initWear(&ctx);
+		ctx.quant = &window;
+		for (size_t i = 0; i < s->n; i += QUANT_WINDOW) {
+			initWearQuant(&window);
+			accumulateWearBatch(&ctx, s->rpm + i, s->spd + i, s->brk + i, (s->n - i < QUANT_WINDOW)? s->n - i: QUANT_WINDOW);
+			addWearQuantWide(&agg, &window);
+			for (int b = 0; b < QSKETCH_BUCKETS; b++)
+				ref[b] += window.rpm.count[b];
+		}
+	}
+
+	for (int b = 0; b < QSKETCH_BUCKETS; b++) {
+		ok &= agg.rpm.count[b] == ref[b];
+		most = (ref[b] > most)? ref[b]: most;
+	}
+	ok &= most > QSKETCH_COUNT_MAX && qsketchWideTotal(&agg.rpm) == (wear_wide_t) s->n*QUANT_PASSES;
+
+	//QUANT_PASSES copias do mesmo fluxo: mesma mediana de uma passada so
+	initWearQuant(&window);
+	initWear(&ctx);
+	ctx.quant = &window;
+	for (size_t i = 0; i < s->n; i++)
+		accumulateWearCtx(&ctx, s->rpm[i], s->spd[i], s->brk[i]);
+	p50 = qsketchWideQuantile(&agg.rpm, 500);
+	ok &= p50 == qsketchQuantile(&window.rpm, 500) || qsketchTotal(&window.rpm) != (wear_wide_t) s->n;
+	qsketchWideClasses(&agg.rpm, rpm_t, classes);
+	ok &= classes[0] + classes[1] + classes[2] + classes[3] == (wear_wide_t) s->n*QUANT_PASSES;
+	report("quantile wide merge", s, ok);
+}
+
+typedef struct {	//sequencia de janelas fechadas, resumida num hash
+	unsigned long hash, windows;
+} window_log_t;
+
+
+static void logWindow(void *user, char window, unsigned char data) {
+	window_log_t *log = (window_log_t *) user;
+
+	log->hash = log->hash*31 + (unsigned long) ((window << 8) | data);
+	log->windows++;
+}
+
+
+static const size_t multi_sizes[MULTI_K] = {200, 1024, 4096};
+
+
+// uma janela independente por tamanho; em swap_at o perfil p e pedido e entra
+// na primeira amostra que fecha alguma janela, recomecando todas
+static void scalarMulti(const stream_t *s, size_t swap_at, const wear_profile_t *p, window_log_t *log) {
+	wear_ctx_t ctx[MULTI_K];
+	size_t fill[MULTI_K] = {0, 0, 0};
+	unsigned char data[2];
+	int pending = 0;
+
+	for (int j = 0; j < MULTI_K; j++)
+		initWear(&ctx[j]);
+	for (size_t i = 0; i < s->n; i++) {
+		int closed = 0;
+
+		pending |= (i == swap_at);
+		for (int j = 0; j < MULTI_K; j++) {
+			accumulateWearCtx(&ctx[j], s->rpm[i], s->spd[i], s->brk[i]);
+			if (++fill[j] == multi_sizes[j]) {
+				wearDataCtx(&ctx[j], data);
+				logWindow(log, (char) j, data[0]);
+				resetWearCtx(&ctx[j], 4);
+				fill[j] = 0;
+				closed = 1;
+			}
+		}
+		if (closed && pending) {
+			for (int j = 0; j < MULTI_K; j++) {
+				setWearProfile(&ctx[j], p);
+				resetWearCtx(&ctx[j], 4);
+				fill[j] = 0;
+			}
+			pending = 0;
+		}
+	}
+}
+
+
+static void checkMulti(const stream_t *s) {
+	const wear_profile_t *p = otherProfile();
+	window_log_t ref, one, batch;
+	wear_multi_t m;
+	size_t swap_at = s->n / 3 + 17;	//longe das bordas
+
+	for (int swap = 0; swap < 2; swap++) {
+		size_t at = swap? swap_at: s->n;
+		int ok;
+
+		memset(&ref, 0, sizeof(ref));
+		memset(&one, 0, sizeof(one));
+		memset(&batch, 0, sizeof(batch));
+		scalarMulti(s, at, p, &ref);
+
+		initWearMulti(&m, multi_sizes, MULTI_K, logWindow, &one);
+		for (size_t i = 0; i < s->n; i++) {
+			if (i == at)
+				requestWearProfile(&m.ctx, p);
+			accumulateWearMulti(&m, s->rpm[i], s->spd[i], s->brk[i]);
+		}
+		ok = !swap || m.ctx.profile == p;
+
+		initWearMulti(&m, multi_sizes, MULTI_K, logWindow, &batch);
+		for (size_t i = 0; i < s->n; ) {
+			size_t step = (s->n - i < MULTI_CHUNK)? s->n - i: MULTI_CHUNK;
+
+			if (i < at && at < i + step)	//o pedido cai entre dois lotes
+				step = at - i;
+			if (i == at)
+				requestWearProfile(&m.ctx, p);
+			accumulateWearMultiBatch(&m, s->rpm + i, s->spd + i, s->brk + i, step);
+			i += step;
+		}
+
+		ok &= ref.windows > 0 && one.hash == ref.hash && one.windows == ref.windows
+			&& batch.hash == ref.hash && batch.windows == ref.windows;
+		report(swap? "multi swap vs scalar": "multi vs scalar", s, ok);
+	}
+}
+
+
+// um veiculo com outro perfil cortado em at e retomado num objeto novo
+static void checkSnapshot(const stream_t *s) {
+	static unsigned char buf[WEAR_MULTI_SNAPSHOT_SIZE], bad[WEAR_MULTI_SNAPSHOT_SIZE];
+	wear_profile_t copy = *otherProfile();	//mesmo perfil em outro endereco
+	window_log_t ref, cut;
+	wear_multi_t m, r, before;
+	size_t at = s->n / 2 + 123;
+	int ok;
+
+	memset(&ref, 0, sizeof(ref));
+	memset(&cut, 0, sizeof(cut));
+	initWearMulti(&m, multi_sizes, MULTI_K, logWindow, &ref);
+	setWearProfile(&m.ctx, otherProfile());
+	for (size_t i = 0; i < s->n; i++)
+		accumulateWearMulti(&m, s->rpm[i], s->spd[i], s->brk[i]);
+
+	initWearMulti(&m, multi_sizes, MULTI_K, logWindow, &cut);
+	setWearProfile(&m.ctx, otherProfile());
+	for (size_t i = 0; i < at; i++)
+		accumulateWearMulti(&m, s->rpm[i], s->spd[i], s->brk[i]);
+	wearMultiSnapshot(&m, buf);
+	initWearMulti(&r, multi_sizes, MULTI_K, logWindow, &cut);
+	setWearProfile(&r.ctx, &copy);
+	ok = wearMultiRestore(&r, buf);
+	for (size_t i = at; i < s->n; i++)
+		accumulateWearMulti(&r, s->rpm[i], s->spd[i], s->brk[i]);
+	report("snapshot round trip", s, ok && cut.hash == ref.hash && cut.windows == ref.windows);
+
+	// cada buffer ruim e recusado e deixa o alvo como estava
+	before = r;
+	memcpy(bad, buf, sizeof(bad));
+	bad[40] ^= 0x10;	//contador do ctx
+	ok = !wearMultiRestore(&r, bad);
+	memcpy(bad, buf, sizeof(bad));
+	bad[3] = 0;	//k 0, com CRC valido
+	setCrc(bad, WEAR_MULTI_SNAPSHOT_SIZE - 4);
+	ok &= !wearMultiRestore(&r, bad);
+	setWearProfile(&r.ctx, NULL);	//perfil padrao: nao e o do snapshot
+	ok &= !wearMultiRestore(&r, buf) && !wearRestore(&r.ctx, buf + 4);
+	setWearProfile(&r.ctx, &copy);
+	report("snapshot reject", s, ok && memcmp(&r, &before, sizeof(r)) == 0);
+}
+
+
+// o resumo da viagem que fechou em end (inclusive) contra o histograma por amostra
+static int sameTrip(const stream_t *s, const wear_trip_t *t, size_t start, size_t end) {
+	wear_hist_t ref;
+
+	scalarHist(s, start, end + 1, &ref);
+	return sameHist(&t->trip.hist, &ref) && t->trip.samples == end + 1 - start;
+}
+
+
+static void checkTrip(const stream_t *s) {
+	wear_ctx_t plain, one, batch;
+	wear_trip_t t1, t2;
+	window_log_t ref, w1, w2, e1, e2;
+	unsigned char data[2];
+	size_t start1 = 0, start2 = 0;
+	int ok = 1;
+
+	memset(&ref, 0, sizeof(ref));
+	memset(&w1, 0, sizeof(w1));
+	memset(&w2, 0, sizeof(w2));
+	memset(&e1, 0, sizeof(e1));
+	memset(&e2, 0, sizeof(e2));
+	initWear(&plain);
+	initWear(&one);
+	initWear(&batch);
+	initWearTrip(&t1, &one, TRIP_STOP);
+	initWearTrip(&t2, &batch, TRIP_STOP);
+
+	for (size_t i = 0; i < s->n; i++) {
+		char ev = accumulateWearTrip(&t1, s->rpm[i], s->spd[i], s->brk[i]);
+
+		accumulateWearCtx(&plain, s->rpm[i], s->spd[i], s->brk[i]);
+		if (ev != WEAR_TRIP_NONE)
+			logWindow(&e1, ev, (unsigned char) i);
+		if (ev == WEAR_TRIP_START)
+			start1 = i;
+		else if (ev == WEAR_TRIP_END)
+			ok &= sameTrip(s, &t1, start1, i);
+		if ((i + 1) % TRIP_WINDOW == 0) {
+			wearDataCtx(&plain, data);
+			logWindow(&ref, 0, data[0]);
+			wearDataCtx(&one, data);
+			logWindow(&w1, 0, data[0]);
+			ok &= sameHist(&one.hist, &plain.hist);
+			resetWearCtx(&plain, 4);
+			resetWearCtx(&one, 4);
+		}
+	}
+
+	for (size_t i = 0; i < s->n; ) {
+		size_t end = (s->n - i < TRIP_WINDOW)? s->n: i + TRIP_WINDOW;
+
+		while (i < end) {	//para em cada fronteira de viagem
+			char ev;
+
+			i += accumulateWearTripBatch(&t2, s->rpm + i, s->spd + i, s->brk + i, end - i, &ev);
+			if (ev == WEAR_TRIP_START) {
+				logWindow(&e2, ev, (unsigned char) i);
+				start2 = i;
+			} else if (ev == WEAR_TRIP_END) {
+				logWindow(&e2, ev, (unsigned char) (i - 1));
+				ok &= sameTrip(s, &t2, start2, i - 1);
+			}
+		}
+		if (i % TRIP_WINDOW == 0) {
+			wearDataCtx(&batch, data);
+			logWindow(&w2, 0, data[0]);
+			resetWearCtx(&batch, 4);
+		}
+	}
+
+	ok &= w1.hash == ref.hash && w2.hash == ref.hash && w2.windows == ref.windows;
+	ok &= e1.windows > 0 && e1.hash == e2.hash && e1.windows == e2.windows;
+	report("trip vs scalar", s, ok);
+}
+
+
+static void checkStream(const stream_t *s) {
+	checkLut(s);
+	checkBatch(s);
+	checkProfile(s);
+	checkProfileSwap(s);
+	checkSlide(s);
+	checkRollup(s);
+	checkQuantile(s);
+	checkQuantileWide(s);
+	checkMulti(s);
+	checkSnapshot(s);
+	checkTrip(s);
+}
+
+
+int main(int argc, char *argv[]) {
+	stream_t synth, idle, recorded;
+
+	if (!allocStream(&synth, "synthetic", SYNTH_SAMPLES) || !allocStream(&idle, "idle", SYNTH_SAMPLES)) {
+		fprintf(stderr, "Sem memoria.\n");
+		return 1;
+	}
+	synthStream(&synth);
+	checkStream(&synth);
+	idleStream(&idle, &synth);
+	checkStream(&idle);
+
+	if (argc > 1) {
+		if (!loadStream(&recorded, argv[1])) {
+			fprintf(stderr, "Nao foi possivel ler %s.\n", argv[1]);
+			return 1;
+		}
+		checkStream(&recorded);
+	}
+
+	return failures > 0;
+}
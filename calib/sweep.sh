@@ -0,0 +1,6 @@
+#!/bin/sh
+# compila e roda a varredura de calibracao (Linux)
+# uso: calib/sweep.sh [-w janela] [-j threads] [-n top] [-o perfil.bin] fluxo.bin rotulos.txt configs.txt
+root="$(dirname "$0")/.."
+gcc -O2 -march=native -pthread -I "$root/sketch" -o "$root/calib/wear_sweep" "$root/calib/wear_sweep.c" "$root"/sketch/*.c || exit 1
+"$root/calib/wear_sweep" "$@"
@@ -0,0 +1,427 @@
+/*
+ * Varredura de calibracao do motor de desgaste. Le o fluxo uma vez (int16
+ * little-endian rpm, spd, brk por amostra, o mesmo de bench/export_stream.py),
+ * avalia todas as combinacoes do arquivo de configuracoes em janelas de
+ * tamanho fixo e ordena pelo erro contra os rotulos.
+ *
+ * Configuracoes, uma chave por linha, alternativas separadas por |; chaves
+ * ausentes ficam com o valor de WEAR_DEFAULT_PROFILE:
+ *   rpm = 1500,2500,3500 | 1200,2200,3200
+ *   brake_weight = 0,1,5,8 | 0,1,4,6
+ * Rotulos no formato de wear.txt, uma linha por janela:
+ *   {brake: 1, clutch: 0, engine: 2},
+ *
+ * Usa accumulateWearRaw/foldWearRaw de abrasion.c: configuracoes com os mesmos
+ * limiares dividem uma passada pelo fluxo e so as tabelas e pesos mudam. Os
+ * grupos de limiares sao repartidos entre as threads.
+ *
+ * -o grava a melhor configuracao como perfil binario (wear_profile.h), para
+ * carregar sem recompilar.
+ *
+ * uso: wear_sweep [-w janela] [-j threads] [-n top] [-o perfil.bin] fluxo.bin rotulos.txt configs.txt
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "abrasion.h"
+#include "wear_profile.h"
+
+#define MAX_ALTS	64
+#define MAX_CONFIGS	(1 << 18)
+#define MAX_VALUES	ENGINE_WEAR_LEN
+#define LINE_LEN	4096
+
+typedef struct {
+	const char *key;
+	size_t offset;
+	char is_short;
+	int len;
+} field_t;
+
+// limiares primeiro: o indice da configuracao os varia mais devagar, entao um
+// grupo de limiares iguais e um trecho contiguo
+static const field_t FIELDS[] = {
+	{"rpm", offsetof(wear_profile_t, rpm), 1, 3},
+	{"spd", offsetof(wear_profile_t, spd), 1, 3},
+	{"rpm_rate", offsetof(wear_profile_t, rpm_rate), 1, 3},
+	{"brk_rate", offsetof(wear_profile_t, brk_rate), 1, 3},
+	{"rpm_weight", offsetof(wear_profile_t, rpm_weight), 0, 4},
+	{"brake_weight", offsetof(wear_profile_t, brake_weight), 0, 4},
+	{"clutch_weight", offsetof(wear_profile_t, clutch_weight), 0, 4},
+	{"brake_wear", offsetof(wear_profile_t, brake_wear), 0, BRAKE_WEAR_LEN},
+	{"clutch_wear", offsetof(wear_profile_t, clutch_wear), 0, CLUTCH_WEAR_LEN},
+	{"engine_wear", offsetof(wear_profile_t, engine_wear), 0, ENGINE_WEAR_LEN},
+};
+#define N_FIELDS	((int) (sizeof(FIELDS) / sizeof(FIELDS[0])))
+#define N_THRESH	4
+
+typedef struct {
+	wear_profile_t profile;
+	char valid;
+	unsigned long long err;		//soma de |classe - rotulo| dos tres componentes
+	size_t exact;				//janelas com o byte igual ao rotulo
+	size_t index;
+} config_t;
+
+typedef struct {
+	int16_t *rpm, *spd, *brk;
+	size_t window, windows;
+	unsigned char *label;
+	config_t *cfg;
+	size_t group_size, groups, next_group;
+	pthread_mutex_t lock;
+} sweep_t;
+
+static short alts[N_FIELDS][MAX_ALTS][MAX_VALUES];
+static int n_alts[N_FIELDS];
+
+
+static void getField(const wear_profile_t *p, int f, short v[]) {
+	const char *base = (const char *) p + FIELDS[f].offset;
+
+	for (int i = 0; i < FIELDS[f].len; i++)
+		v[i] = FIELDS[f].is_short? ((const short *) base)[i]: base[i];
+}
+
+
+static void setField(wear_profile_t *p, int f, const short v[]) {
+	char *base = (char *) p + FIELDS[f].offset;
+
+	for (int i = 0; i < FIELDS[f].len; i++) {
+		if (FIELDS[f].is_short)
+			((short *) base)[i] = v[i];
+		else
+			base[i] = (char) v[i];
+	}
+}
+
+
+static int parseValues(char *s, short v[], int len) {	//"1,2,3" -> v, 0 se o tamanho nao confere
+	int n = 0;
+	char *end;
+
+	for (;;) {
+		long x = strtol(s, &end, 0);
+
+		if (end == s || n == len)
+			return 0;
+		v[n++] = (short) x;
+		while (*end == ' ' || *end == '\t')
+			end++;
+		if (*end != ',')
+			break;
+		s = end + 1;
+	}
+	while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n')
+		end++;
+	return *end == '\0' && n == len;
+}
+
+
+static int loadConfigs(const char *path) {
+	FILE *f = fopen(path, "r");
+	char line[LINE_LEN];
+	int lineno = 0;
+
+	if (f == NULL)
+		return 0;
+	for (int k = 0; k < N_FIELDS; k++) {
+		n_alts[k] = 1;
+		getField(&WEAR_DEFAULT_PROFILE, k, alts[k][0]);
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char *eq = strchr(line, '='), *key = line, *alt;
+		int k;
+
+		lineno++;
+		if (line[strspn(line, " \t\r\n")] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+		if (eq == NULL) {
+			fprintf(stderr, "%s:%d: falta '='\n", path, lineno);
+			fclose(f);
+			return 0;
+		}
+		*eq = '\0';
+		key += strspn(key, " \t");
+		key[strcspn(key, " \t")] = '\0';
+		for (k = 0; k < N_FIELDS && strcmp(key, FIELDS[k].key) != 0; k++);
+		if (k == N_FIELDS) {
+			fprintf(stderr, "%s:%d: chave desconhecida '%s'\n", path, lineno, key);
+			fclose(f);
+			return 0;
+		}
+
+		n_alts[k] = 0;
+		for (alt = strtok(eq + 1, "|"); alt != NULL; alt = strtok(NULL, "|")) {
+			if (n_alts[k] == MAX_ALTS || !parseValues(alt, alts[k][n_alts[k]], FIELDS[k].len)) {
+				fprintf(stderr, "%s:%d: '%s' espera %d valores por alternativa, ate %d alternativas\n",
+					path, lineno, key, FIELDS[k].len, MAX_ALTS);
+				fclose(f);
+				return 0;
+			}
+			n_alts[k]++;
+		}
+	}
+	fclose(f);
+	return 1;
+}
+
+
+static config_t *expandConfigs(size_t *count, size_t *group_size) {
+	size_t total = 1, gs = 1;
+	config_t *cfg;
+
+	for (int k = 0; k < N_FIELDS; k++) {
+		if (total > (size_t) (MAX_CONFIGS / n_alts[k]))
+			return NULL;
+		total *= n_alts[k];
+		if (k >= N_THRESH)
+			gs *= n_alts[k];
+	}
+
+	cfg = (config_t *) calloc(total, sizeof(config_t));
+	if (cfg == NULL)
+		return NULL;
+	for (size_t i = 0; i < total; i++) {
+		size_t rest = i;
+
+		for (int k = N_FIELDS - 1; k >= 0; k--) {	//ultimo campo varia mais rapido
+			setField(&cfg[i].profile, k, alts[k][rest % n_alts[k]]);
+			rest /= n_alts[k];
+		}
+		cfg[i].valid = checkWearProfile(&cfg[i].profile);
+		cfg[i].index = i;
+	}
+
+	*count = total;
+	*group_size = gs;
+	return cfg;
+}
+
+
+static size_t loadStream(sweep_t *sw, const char *path) {
+	FILE *f = fopen(path, "rb");
+	unsigned char b[6];
+	size_t n;
+	long size;
+
+	if (f == NULL)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	n = (size > 0)? size / 6: 0;
+	sw->rpm = (int16_t *) malloc((n + 1)*sizeof(int16_t));
+	sw->spd = (int16_t *) malloc((n + 1)*sizeof(int16_t));
+	sw->brk = (int16_t *) malloc((n + 1)*sizeof(int16_t));
+	if (sw->rpm == NULL || sw->spd == NULL || sw->brk == NULL) {
+		fclose(f);
+		return 0;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		if (fread(b, 1, 6, f) != 6) {
+			n = i;
+			break;
+		}
+		sw->rpm[i] = (int16_t) (b[0] | (b[1] << 8));
+		sw->spd[i] = (int16_t) (b[2] | (b[3] << 8));
+		sw->brk[i] = (int16_t) (b[4] | (b[5] << 8));
+	}
+	fclose(f);
+	return n;
+}
+
+
+static size_t loadLabels(sweep_t *sw, const char *path, size_t max) {
+	FILE *f = fopen(path, "r");
+	char line[LINE_LEN];
+	size_t n = 0;
+	int b, c, e;
+
+	if (f == NULL)
+		return 0;
+	sw->label = (unsigned char *) malloc(max + 1);
+	while (sw->label != NULL && n < max && fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, " {brake: %d, clutch: %d, engine: %d}", &b, &c, &e) == 3)
+			sw->label[n++] = (unsigned char) (((b & 3) << 4) | ((c & 3) << 2) | (e & 3));
+	}
+	fclose(f);
+	return n;
+}
+
+
+static int classDiff(unsigned char a, unsigned char b) {
+	int d = (a & 3) - (b & 3);
+
+	return (d < 0)? -d: d;
+}
+
+
+static void evalGroup(sweep_t *sw, size_t g) {
+	config_t *cfg = sw->cfg + g*sw->group_size;
+	wear_ctx_t ctx;
+	size_t c, w;
+
+	for (c = 0; c < sw->group_size && !cfg[c].valid; c++);
+	if (c == sw->group_size)
+		return;
+
+	initWear(&ctx);
+	setWearProfile(&ctx, &cfg[c].profile);	//o grupo todo tem os mesmos limiares
+	for (w = 0; w < sw->windows; w++) {
+		size_t at = w*sw->window;
+		wear_raw_t raw;
+
+		memset(&raw, 0, sizeof(raw));
+		accumulateWearRaw(&ctx, sw->rpm + at, sw->spd + at, sw->brk + at, sw->window, &raw);
+
+		for (c = 0; c < sw->group_size; c++) {
+			wear_hist_t hist;
+			unsigned char data[2], label = sw->label[w];
+
+			if (!cfg[c].valid)
+				continue;
+			memset(&hist, 0, sizeof(hist));
+			foldWearRaw(&raw, &cfg[c].profile, &hist);
+			wearDataProfile(&hist, &cfg[c].profile, data);
+			cfg[c].err += classDiff(data[0] >> 4, label >> 4) + classDiff(data[0] >> 2, label >> 2) + classDiff(data[0], label);
+			cfg[c].exact += (data[0] == label);
+		}
+	}
+}
+
+
+static void *worker(void *arg) {
+	sweep_t *sw = (sweep_t *) arg;
+
+	for (;;) {
+		size_t g;
+
+		pthread_mutex_lock(&sw->lock);
+		g = sw->next_group++;
+		pthread_mutex_unlock(&sw->lock);
+		if (g >= sw->groups)
+			return NULL;
+		evalGroup(sw, g);
+	}
+}
+
+
+static int saveProfile(const char *path, const wear_profile_t *p) {
+	unsigned char buf[WEAR_PROFILE_SIZE];
+	FILE *f = fopen(path, "wb");
+	size_t len;
+
+	if (f == NULL)
+		return 0;
+	wearProfileEncode(p, buf);
+	len = fwrite(buf, 1, sizeof(buf), f);
+	return (fclose(f) == 0) && len == sizeof(buf);
+}
+
+
+static int byScore(const void *a, const void *b) {
+	const config_t *x = (const config_t *) a, *y = (const config_t *) b;
+
+	if (x->valid != y->valid)
+		return y->valid - x->valid;
+	if (x->err != y->err)
+		return (x->err < y->err)? -1: 1;
+	if (x->exact != y->exact)
+		return (x->exact > y->exact)? -1: 1;
+	return (x->index < y->index)? -1: (x->index > y->index);
+}
+
+
+static void printConfig(const config_t *c, size_t rank, size_t windows) {
+	short v[MAX_VALUES];
+
+	printf("%zu\terr %llu\texact %zu/%zu\t", rank, c->err, c->exact, windows);
+	for (int k = 0; k < N_FIELDS; k++) {
+		if (n_alts[k] < 2)	//so os campos varridos
+			continue;
+		getField(&c->profile, k, v);
+		printf(" %s=", FIELDS[k].key);
+		for (int i = 0; i < FIELDS[k].len; i++)
+			printf("%s%d", i? ",": "", v[i]);
+	}
+	printf("\n");
+}
+
+
+int main(int argc, char **argv) {
+	sweep_t sw;
+	size_t samples, labels, count, top = 10, invalid = 0;
+	const char *out_path = NULL;
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t *pool;
+	int opt;
+
+	memset(&sw, 0, sizeof(sw));
+	sw.window = 1024;
+	while ((opt = getopt(argc, argv, "w:j:n:o:")) != -1) {
+		switch (opt) {
+		case 'w': sw.window = strtoul(optarg, NULL, 0); break;
+		case 'j': threads = strtol(optarg, NULL, 0); break;
+		case 'n': top = strtoul(optarg, NULL, 0); break;
+		case 'o': out_path = optarg; break;
+		default: optind = argc + 1; break;
+		}
+	}
+	if (argc - optind != 3 || sw.window == 0) {
+		fprintf(stderr, "uso: %s [-w janela] [-j threads] [-n top] [-o perfil.bin] fluxo.bin rotulos.txt configs.txt\n", argv[0]);
+		return 1;
+	}
+	if (threads < 1)
+		threads = 1;
+
+	samples = loadStream(&sw, argv[optind]);
+	if (samples < sw.window) {
+		fprintf(stderr, "%s: fluxo vazio ou menor que uma janela\n", argv[optind]);
+		return 1;
+	}
+	labels = loadLabels(&sw, argv[optind + 1], samples / sw.window);
+	if (labels == 0) {
+		fprintf(stderr, "%s: nenhum rotulo\n", argv[optind + 1]);
+		return 1;
+	}
+	if (labels < samples / sw.window)
+		fprintf(stderr, "%zu janelas no fluxo, %zu rotulos: avaliando %zu\n", samples / sw.window, labels, labels);
+	sw.windows = labels;
+
+	if (!loadConfigs(argv[optind + 2]))
+		return 1;
+	sw.cfg = expandConfigs(&count, &sw.group_size);
+	if (sw.cfg == NULL) {
+		fprintf(stderr, "mais de %d configuracoes\n", MAX_CONFIGS);
+		return 1;
+	}
+	sw.groups = count / sw.group_size;
+
+	pthread_mutex_init(&sw.lock, NULL);
+	pool = (pthread_t *) malloc(threads*sizeof(pthread_t));
+	for (long t = 0; t < threads; t++)
+		pthread_create(&pool[t], NULL, worker, &sw);
+	for (long t = 0; t < threads; t++)
+		pthread_join(pool[t], NULL);
+
+	for (size_t i = 0; i < count; i++)
+		invalid += !sw.cfg[i].valid;
+	qsort(sw.cfg, count, sizeof(config_t), byScore);
+
+	fprintf(stderr, "%zu configuracoes (%zu invalidas), %zu grupos de limiares, %zu janelas de %zu, %ld threads\n",
+		count, invalid, sw.groups, sw.windows, sw.window, threads);
+	for (size_t i = 0; i < top && i < count - invalid; i++)
+		printConfig(&sw.cfg[i], i + 1, sw.windows);
+
+	if (out_path != NULL && count > invalid && !saveProfile(out_path, &sw.cfg[0].profile)) {
+		fprintf(stderr, "%s: falha ao gravar\n", out_path);
+		return 1;
+	}
+	return 0;
+}
@@ -27,6 +27,8 @@ def main():
 	_variables = []
 	#########################
 
+	_window = 1024			#janela principal do a.exe, usada no modo native
+
 	_index = 0
 	try:
 		device, _logs_path, _log_names, _log_files, _variables, send_function, recv_function = configEnvoirement(_config_file)
@@ -52,7 +54,23 @@ def main():
 
 		batch = tame_dset(batch, _batch_sizes, _variables)
 
-		if(device != None):
+		if(device != None and setup.TCP):
+			#todas as amostras de uma vez, em lotes com cada variavel contigua; o a.exe confirma em lotes
+			fields = [np.asarray(batch[j]).astype('>i2').tobytes() for j in _variables]
+			wear = send_function(device, fields)
+			print("%d samples sent" %(len(fields[0])//2))
+
+			for d in wear:
+				brk, clu, eng = decode(bytes([d]))
+				output["brk"].append(brk)
+				output["clu"].append(clu)
+				output["eng"].append(eng)
+
+			rpm_rate = np.diff(np.concatenate(([0], batch["rpm"])))
+			brk_rate = np.clip(np.diff(np.concatenate(([0], batch["brake_user"]))), -300, 300)
+			print(output)
+
+		elif(device != None):
 			for i in range(0, _batch_sizes[1]):
 				data_received = 0
 				d = []
@@ -93,6 +111,21 @@ def main():
 		
 			print(output)
 
+		elif(setup.NATIVE):
+			from lib import wear		#python ext/build.py build_ext --inplace
+			samples = [np.ascontiguousarray(batch[j], dtype=np.int16) for j in _variables]
+			data, hist, score = wear.score(samples[0], samples[1], samples[2], _window)
+
+			for s in np.asarray(score):	#Q8.8, continuo em vez das classes de 2 bits
+				output["brk"].append(s[0]/256)
+				output["clu"].append(s[1]/256)
+				output["eng"].append(s[2]/256)
+
+			#mesmas derivadas do envio amostra a amostra
+			rpm_rate = np.diff(np.concatenate(([0], batch["rpm"])))
+			brk_rate = np.clip(np.diff(np.concatenate(([0], batch["brake_user"]))), -300, 300)
+			print(output)
+
 		if(setup.DSETPLOT):
 			name = log_name[:len(log_name)-3]+'-'
 			tri_d_plot(name+"3dplot.png", (batch["rpm"], batch["speed"], batch["brake_user"]), dpi)
@@ -113,8 +146,8 @@ def main():
 			for i in range(0, size):
 				for j in range(0, copy):
 					outputx["rpm"].append(floor(output["eng"][i]*max_value/3))
-					outputx["brk_rate"].append(floor(output["brk"][i]))
-					outputx["rpm_rate"].append(floor(output["clu"][i]))
+					outputx["brk_rate"].append(output["brk"][i])
+					outputx["rpm_rate"].append(output["clu"][i])
 			
 			for i in _variables:
 
@@ -176,14 +209,15 @@ def main():
 					else:
 						plot_var(name, i, dpi, (x, y, 'b'))
 		_index += 1
-		time.sleep(5)
+		if(device != None):
+			time.sleep(5)
 
 	return 0
 
 
 if __name__ == "__main__":
 
-	if( setup.Init(ARGS = ["debug", "serial", "tcp", "savefigs", "dsetplot"]) == setup.FAIL):
+	if( setup.Init(ARGS = ["debug", "serial", "tcp", "savefigs", "dsetplot", "native"]) == setup.FAIL):
 		pass
 	else:
 		main()
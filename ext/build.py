@@ -0,0 +1,9 @@
+# compila o modulo wear (ext/wearmodule.c) com o motor de sketch/
+# uso, da raiz do repositorio: python ext/build.py build_ext --inplace
+import sys
+from setuptools import setup, Extension
+
+sources = ["ext/wearmodule.c", "sketch/abrasion.c", "sketch/abrasion_batch.c", "sketch/wear_quantile.c"]
+flags = [] if sys.platform == "win32" else ["-O2", "-march=native"]
+
+setup(name="wear", ext_modules=[Extension("lib.wear", sources, include_dirs=["sketch"], extra_compile_args=flags)])
@@ -0,0 +1,172 @@
+/*
+ * Modulo Python com o motor de desgaste (sketch/abrasion.c), para pontuar
+ * logs sem passar cada amostra pela serial/TCP. Os vetores chegam pelo
+ * buffer protocol (numpy, array.array, bytes) e sao lidos sem copia; tem que
+ * ser int16 contiguos, como os que o dispositivo recebe.
+ *
+ *   data, hist, score = wear.score(rpm, spd, brk, window=1024)
+ *
+ * data: bytes, um byte de desgaste por janela completa (o mesmo que a.exe envia)
+ * hist: memoryview uint32 (janelas, 3, 4) com brake, clutch e rpm de cada janela;
+ *       vazio e unidimensional se nao ha janela completa
+ * score: memoryview uint16 (janelas, 3), brake, clutch e engine em Q8.8
+ *        (wear_score_t, de 0 a 3.0), idem
+ *
+ * compilar: python ext/build.py build_ext --inplace (gera lib/wear*.so)
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "abrasion.h"
+
+#define HIST_COUNTERS	12	//brake[4], clutch[4], rpm[4]
+#define SCORES			3	//brake, clutch, engine
+
+
+static int getSamples(PyObject *obj, Py_buffer *view, const char *name) {
+	const char *fmt;
+
+	if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0)
+		return 0;
+
+	fmt = (view->format != NULL)? view->format: "B";
+	if (*fmt == '@' || *fmt == '=' || *fmt == '<')	//ordem nativa; os alvos sao little-endian
+		fmt++;
+	if (strcmp(fmt, "h") != 0) {
+		PyErr_Format(PyExc_TypeError, "%s: esperado int16 contiguo, veio '%s'; use np.ascontiguousarray(x, dtype=np.int16)",
+			name, view->format? view->format: "B");
+		PyBuffer_Release(view);
+		return 0;
+	}
+	return 1;
+}
+
+
+static uint32_t toU32(wear_acc_t v) {
+#if WEAR_ACC_BITS == 64
+	return (v > UINT32_MAX)? UINT32_MAX: (uint32_t) v;
+#else
+	return v;
+#endif
+}
+
+
+static void scoreWindows(const int16_t *rpm, const int16_t *spd, const int16_t *brk, Py_ssize_t windows, Py_ssize_t window,
+		unsigned char *data, uint32_t *hist, uint16_t *score) {
+	wear_ctx_t ctx;
+
+	initWear(&ctx);
+	for (Py_ssize_t w = 0; w < windows; w++) {
+		unsigned char d[2];
+		uint32_t *h = hist + HIST_COUNTERS*w;
+		wear_score_t s;
+
+		resetWearCtx(&ctx, 4);
+		accumulateWearBatch(&ctx, rpm + w*window, spd + w*window, brk + w*window, (size_t) window);
+		wearDataCtx(&ctx, d);
+		data[w] = d[0];
+		wearScoreCtx(&ctx, &s);
+		score[SCORES*w] = s.brake;
+		score[SCORES*w + 1] = s.clutch;
+		score[SCORES*w + 2] = s.engine;
+		for (int i = 0; i < 4; i++) {
+			h[i] = toU32(ctx.hist.brake[i]);
+			h[4 + i] = toU32(ctx.hist.clutch[i]);
+			h[8 + i] = toU32(ctx.hist.rpm[i]);
+		}
+	}
+}
+
+
+static PyObject *shapedView(PyObject *bytes, const char *format, Py_ssize_t windows, int per_window) {	//consome bytes
+	PyObject *view = PyMemoryView_FromObject(bytes), *shaped;
+
+	Py_DECREF(bytes);
+	if (view == NULL)
+		return NULL;
+	if (windows == 0)
+		shaped = PyObject_CallMethod(view, "cast", "s", format);	//cast nao aceita dimensao 0
+	else if (per_window == HIST_COUNTERS)
+		shaped = PyObject_CallMethod(view, "cast", "s(nii)", format, windows, 3, 4);
+	else
+		shaped = PyObject_CallMethod(view, "cast", "s(ni)", format, windows, per_window);
+	Py_DECREF(view);
+	return shaped;
+}
+
+
+static PyObject *score(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static char *keywords[] = {"rpm", "spd", "brk", "window", NULL};
+	PyObject *obj[3], *data, *hist, *scores, *hist_view, *score_view, *out = NULL;
+	Py_buffer buf[3];
+	Py_ssize_t window = 1024, n, windows;
+	int got = 0;
+
+	(void) self;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|n", keywords, &obj[0], &obj[1], &obj[2], &window))
+		return NULL;
+	if (window <= 0) {
+		PyErr_SetString(PyExc_ValueError, "window deve ser maior que 0");
+		return NULL;
+	}
+
+	for (got = 0; got < 3; got++) {
+		if (!getSamples(obj[got], &buf[got], keywords[got]))
+			goto done;
+	}
+	n = buf[0].len / 2;
+	if (buf[1].len / 2 != n || buf[2].len / 2 != n) {
+		PyErr_SetString(PyExc_ValueError, "rpm, spd e brk devem ter o mesmo tamanho");
+		goto done;
+	}
+	windows = n / window;
+
+	data = PyBytes_FromStringAndSize(NULL, windows);
+	hist = PyByteArray_FromStringAndSize(NULL, windows*HIST_COUNTERS*sizeof(uint32_t));
+	scores = PyByteArray_FromStringAndSize(NULL, windows*SCORES*sizeof(uint16_t));
+	if (data == NULL || hist == NULL || scores == NULL) {
+		Py_XDECREF(data);
+		Py_XDECREF(hist);
+		Py_XDECREF(scores);
+		goto done;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	scoreWindows((const int16_t *) buf[0].buf, (const int16_t *) buf[1].buf, (const int16_t *) buf[2].buf, windows, window,
+		(unsigned char *) PyBytes_AS_STRING(data), (uint32_t *) PyByteArray_AS_STRING(hist), (uint16_t *) PyByteArray_AS_STRING(scores));
+	Py_END_ALLOW_THREADS
+
+	hist_view = shapedView(hist, "I", windows, HIST_COUNTERS);
+	score_view = shapedView(scores, "H", windows, SCORES);
+	if (hist_view == NULL || score_view == NULL) {
+		Py_DECREF(data);
+		Py_XDECREF(hist_view);
+		Py_XDECREF(score_view);
+		goto done;
+	}
+	out = Py_BuildValue("(NNN)", data, hist_view, score_view);
+
+done:
+	while (got-- > 0)
+		PyBuffer_Release(&buf[got]);
+	return out;
+}
+
+
+static PyMethodDef wear_methods[] = {
+	{"score", (PyCFunction) (void (*)(void)) score, METH_VARARGS | METH_KEYWORDS,
+		"score(rpm, spd, brk, window=1024) -> (data, hist, score)\n\n"
+		"Byte de desgaste, histograma e score Q8.8 de cada janela completa; rpm, spd e brk int16."},
+	{NULL, NULL, 0, NULL}
+};
+
+
+static struct PyModuleDef wear_module = {
+	PyModuleDef_HEAD_INIT, "wear", "Motor de desgaste de sketch/abrasion.c", -1, wear_methods,
+	NULL, NULL, NULL, NULL
+};
+
+
+PyMODINIT_FUNC PyInit_wear(void) {
+	return PyModule_Create(&wear_module);
+}
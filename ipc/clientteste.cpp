@@ -35,6 +35,7 @@ int main(int argc , char *argv[])
         }
 
         printHex(server_reply);
+        free(server_reply);
     	sendData(scoket, "teste");
     }
 
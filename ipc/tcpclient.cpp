@@ -5,6 +5,7 @@
 
 int initWINSOCK()
 {
+#ifdef _WIN32
     WSADATA wsa;
 
     printf("\nInitialising Winsock...");
@@ -15,6 +16,7 @@ int initWINSOCK()
     }
      
     printf("Initialised.\n");
+#endif
 
     return 0;
 }
@@ -24,7 +26,7 @@ void initSocket(SOCKET *s)
     //Create a socket
     if((*s = socket(AF_INET , SOCK_STREAM , 0 )) == INVALID_SOCKET)
     {
-        printf("Could not create socket : %d\n" , WSAGetLastError());
+        printf("Could not create socket\n");
     }
  
     printf("Socket created.\n");
@@ -47,13 +49,22 @@ int connect(SOCKET s, char const *ip, int port)
         return 1;
     }
      
+    //acks e bytes de desgaste sao pequenos, sem Nagle eles nao ficam esperando o ack do TCP
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *) &one, sizeof(one));
+
     printf("Connected\n");
     return 0;
 }
 
 int sendData(SOCKET s, char *message)
 {
-    if( send(s , message , strlen(message) , 0) < 0)
+    return sendData(s, message, strlen(message));
+}
+
+int sendData(SOCKET s, char *message, int size)
+{
+    if( send(s , message , size , 0) < 0)
     {
         printf("Send failed\n");
         return 1;
@@ -62,17 +73,92 @@ int sendData(SOCKET s, char *message)
     return 0;
 }
 
-char *recData(SOCKET s, int size, bool to_string)
+int pendingData(SOCKET s)
+{
+#ifdef _WIN32
+    u_long n = 0;
+    ioctlsocket(s, FIONREAD, &n);
+#else
+    int n = 0;
+    ioctl(s, FIONREAD, &n);
+#endif
+    return (int) n;
+}
+
+char *recData(SOCKET s, int size, bool to_string)  //espera os size bytes; NULL se a conexao caiu ou fechou
 {
     int recv_size;
     char *server_reply;
     server_reply = (char *) malloc((size + 1)*sizeof(char));
 
-    if((recv_size = recv(s , server_reply , size , 0)) == SOCKET_ERROR)
+    if((recv_size = recv(s , server_reply , size , MSG_WAITALL)) == SOCKET_ERROR || recv_size < size)
     {
         printf("Recv failed\n");
+        free(server_reply);
         return NULL;
     }
+    if(to_string)
+        server_reply[recv_size] = '\0';
 
     return server_reply;
-}
\ No newline at end of file
+}
+
+void initRecvRing(recv_ring_t *r, char *buf, int size)
+{
+    r->buf = buf;
+    r->size = size;
+    r->start = r->len = 0;
+}
+
+int recvInto(recv_ring_t *r, SOCKET s)
+{
+    int n;
+
+    //pouco espaco no fim: leva o resto ainda nao consumido, menos de uma mensagem, para o inicio
+    if(r->start > 0 && r->size - (r->start + r->len) < r->size/2)
+    {
+        memmove(r->buf, r->buf + r->start, r->len);
+        r->start = 0;
+    }
+    if(r->len == r->size)   //mensagem maior que o buffer
+    {
+#ifdef _WIN32
+        WSASetLastError(WSAEMSGSIZE);
+#else
+        errno = EMSGSIZE;
+#endif
+        return SOCKET_ERROR;
+    }
+
+    n = recv(s, r->buf + r->start + r->len, r->size - (r->start + r->len), 0);
+    if(n > 0)
+        r->len += n;
+    return n;
+}
+
+char *recData(recv_ring_t *r, int size)
+{
+    char *msg;
+
+    if(r->len < size)
+        return NULL;
+    msg = r->buf + r->start;
+    r->start += size;
+    r->len -= size;
+    return msg;
+}
+
+char *recData(SOCKET s, recv_ring_t *r, int size)
+{
+    char *msg;
+
+    while((msg = recData(r, size)) == NULL)
+    {
+        if(recvInto(r, s) <= 0)
+        {
+            printf("Recv failed\n");
+            return NULL;
+        }
+    }
+    return msg;
+}
@@ -1,13 +1,45 @@
 #ifndef TCPCLIENT
 #define TCPCLIENT
 
+#ifdef _WIN32
 #include <winsock2.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+typedef int SOCKET;
+#define INVALID_SOCKET  (-1)
+#define SOCKET_ERROR    (-1)
+#define closesocket     close
+#endif
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int initWINSOCK();
+#define RECV_RING_ALIGN 64  //linha de cache; o buffer do anel deve comecar alinhado assim
+
+typedef struct {    //buffer de recepcao do chamador: recv direto nele e mensagens devolvidas sem copia
+    char *buf;
+    int size;
+    int start, len; //parte de buf ainda nao consumida
+} recv_ring_t;
+
+int initWINSOCK();  //fora do Windows nao faz nada
 void initSocket(SOCKET *s);
 int connect(SOCKET s, char const *ip, int port);
 int sendData(SOCKET s, char *message);
-char *recData(SOCKET s, int size, bool too_string);
+int sendData(SOCKET s, char *message, int size);    //binario, pode ter zeros
+int pendingData(SOCKET s);                          //bytes ja recebidos e ainda nao lidos
+char *recData(SOCKET s, int size, bool too_string);    //aloca a cada chamada; o chamador libera com free
+
+void initRecvRing(recv_ring_t *r, char *buf, int size);
+int recvInto(recv_ring_t *r, SOCKET s);             //um recv no espaco livre: bytes lidos, 0 se fechou, SOCKET_ERROR se falhou
+//os ponteiros devolvidos apontam para dentro do anel e valem ate o proximo recvInto
+char *recData(recv_ring_t *r, int size);            //size bytes ja recebidos; NULL se ainda nao chegaram
+char *recData(SOCKET s, recv_ring_t *r, int size);  //espera os size bytes; NULL se a conexao caiu ou fechou
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,245 @@
+/*
+    Varias conexoes TCP por thread com epoll
+*/
+#include "tcppoll.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+
+#define POLL_EVENTS 64  //eventos lidos por epoll_wait
+
+int initPoll(tcp_poll_t *p)
+{
+    if((p->epfd = epoll_create1(0)) < 0)
+    {
+        printf("epoll_create failed : %d\n", errno);
+        return 1;
+    }
+    return 0;
+}
+
+void closePoll(tcp_poll_t *p)
+{
+    close(p->epfd);
+    p->epfd = -1;
+}
+
+int connect(tcp_poll_t *p, tcp_conn_t *c, char const *ip, int port, void *user)
+{
+    c->user = user;
+    c->closed = c->send_failed = false;
+    c->pend_len = 0;
+    initSocket(&c->s);
+    if(c->s == INVALID_SOCKET)
+        return 1;
+    //conecta bloqueando, so a troca de dados e nao bloqueante
+    if(connect(c->s, ip, port) != 0 || fcntl(c->s, F_SETFL, fcntl(c->s, F_GETFL, 0) | O_NONBLOCK) < 0)
+    {
+        close(c->s);
+        c->s = INVALID_SOCKET;
+        return 1;
+    }
+
+    if(addConn(p, c) != 0)
+    {
+        close(c->s);
+        c->s = INVALID_SOCKET;
+        return 1;
+    }
+    return 0;
+}
+
+int addConn(tcp_poll_t *p, tcp_conn_t *c)
+{
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = c;
+    if(epoll_ctl(p->epfd, EPOLL_CTL_ADD, c->s, &ev) < 0)
+    {
+        printf("epoll_ctl failed : %d\n", errno);
+        return 1;
+    }
+    return 0;
+}
+
+void removeConn(tcp_poll_t *p, tcp_conn_t *c)
+{
+    epoll_ctl(p->epfd, EPOLL_CTL_DEL, c->s, NULL);
+}
+
+int listenPoll(tcp_poll_t *p, tcp_conn_t *l, int port)
+{
+    struct sockaddr_in addr;
+    int one = 1;
+
+    l->user = NULL;
+    l->closed = l->send_failed = false;
+    l->pend_len = 0;
+    if((l->s = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == INVALID_SOCKET)
+        return 1;
+    //cada poll tem o seu socket na mesma porta e o kernel reparte as conexoes
+    setsockopt(l->s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(l->s, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if(bind(l->s, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(l->s, SOMAXCONN) < 0 || addConn(p, l) != 0)
+    {
+        printf("Listen failed : %d\n", errno);
+        close(l->s);
+        l->s = INVALID_SOCKET;
+        return 1;
+    }
+    return 0;
+}
+
+int acceptConn(tcp_poll_t *p, tcp_conn_t *l, tcp_conn_t *c, void *user)
+{
+    int one = 1;
+
+    do
+        c->s = accept4(l->s, NULL, NULL, SOCK_NONBLOCK);
+    while(c->s < 0 && (errno == EINTR || errno == ECONNABORTED));
+    if(c->s < 0)
+        return 1;
+
+    c->user = user;
+    c->closed = c->send_failed = false;
+    c->pend_len = 0;
+    setsockopt(c->s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if(addConn(p, c) != 0)
+    {
+        close(c->s);
+        c->s = INVALID_SOCKET;
+        return 1;
+    }
+    return 0;
+}
+
+void closeConn(tcp_poll_t *p, tcp_conn_t *c)
+{
+    if(c->s == INVALID_SOCKET)
+        return;
+    epoll_ctl(p->epfd, EPOLL_CTL_DEL, c->s, NULL);
+    close(c->s);
+    c->s = INVALID_SOCKET;
+    c->closed = true;
+}
+
+int sendData(tcp_conn_t *c, char *message)
+{
+    return sendData(c, message, strlen(message));
+}
+
+static int sendSome(tcp_conn_t *c, char *message, int size)    //bytes enviados sem bloquear; -1 se o envio falhou
+{
+    int sent = 0;
+
+    while(sent < size)
+    {
+        ssize_t n = send(c->s, message + sent, size - sent, MSG_NOSIGNAL);
+
+        if(n >= 0)
+            sent += n;
+        else if(errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        else if(errno != EINTR)
+        {
+            printf("Send failed\n");
+            c->closed = c->send_failed = true;
+            return -1;
+        }
+    }
+    return sent;
+}
+
+static void flushPending(tcp_conn_t *c)
+{
+    int n = sendSome(c, c->pend, c->pend_len);
+
+    if(n > 0)
+    {
+        memmove(c->pend, c->pend + n, c->pend_len - n);
+        c->pend_len -= n;
+    }
+}
+
+int sendData(tcp_conn_t *c, char *message, int size)
+{
+    int sent = 0;
+
+    if(c->send_failed)
+        return 1;
+    if(c->pend_len > 0)
+        flushPending(c);
+    if(c->pend_len == 0 && (sent = sendSome(c, message, size)) < 0)
+        return 1;
+
+    //buffer de envio cheio: guarda o resto, o loop do poll nao espera por uma conexao so
+    if(c->pend_len + size - sent > SEND_PENDING)
+    {
+        printf("Send buffer full\n");
+        c->closed = c->send_failed = true;
+        return 1;
+    }
+    memcpy(c->pend + c->pend_len, message + sent, size - sent);
+    c->pend_len += size - sent;
+    return 0;
+}
+
+static void fill(tcp_conn_t *c, int size)  //le ate EAGAIN, ou ate encher o anel com a mensagem completa
+{
+    while(!c->closed)
+    {
+        int n = recvInto(&c->ring, c->s);
+
+        if(n > 0)
+        {
+            if(c->ring.start + c->ring.len == c->ring.size && c->ring.len >= size)
+                return;     //o resto sai no proximo recData, depois que o chamador consumir
+        }
+        else if(n == 0)
+            c->closed = true;
+        else if(errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+        else if(errno != EINTR)
+            c->closed = true;
+    }
+}
+
+char *recData(tcp_conn_t *c, int size)
+{
+    char *msg = recData(&c->ring, size);
+
+    if(msg == NULL)
+    {
+        fill(c, size);
+        msg = recData(&c->ring, size);
+    }
+    return msg;
+}
+
+int waitPoll(tcp_poll_t *p, tcp_conn_t **ready, int max, int timeout_ms)
+{
+    struct epoll_event ev[POLL_EVENTS];
+    int n, k = 0;
+
+    if(max > POLL_EVENTS)
+        max = POLL_EVENTS;
+    do
+        n = epoll_wait(p->epfd, ev, max, timeout_ms);
+    while(n < 0 && errno == EINTR);
+
+    for(int i = 0; i < n; i++)
+    {
+        tcp_conn_t *c = (tcp_conn_t *) ev[i].data.ptr;
+
+        if((ev[i].events & EPOLLOUT) && c->pend_len > 0 && !c->send_failed)
+            flushPending(c);
+        if((ev[i].events & ~EPOLLOUT) || c->send_failed)    //so EPOLLOUT: nada para o chamador ler
+            ready[k++] = c;
+    }
+    return (n < 0)? n: k;
+}
@@ -0,0 +1,49 @@
+#ifndef TCPPOLL
+#define TCPPOLL
+
+/*
+    Conexoes TCP nao bloqueantes multiplexadas com epoll (so Linux), com a
+    mesma cara de tcpclient: connect, sendData e recData; do lado servidor,
+    listenPoll e acceptConn. Leitura edge-triggered: depois que waitPoll
+    devolve uma conexao, chame recData ate ela devolver NULL, senao o restante
+    so chega no proximo pacote. Se depois disso closed estiver marcado o outro
+    lado fechou; chame closeConn. O buffer de recepcao e do chamador:
+    initRecvRing(&c->ring, ...) antes do connect ou do acceptConn, com espaco
+    para pelo menos uma mensagem. sendData nunca bloqueia: o que nao cabe no
+    socket fica em pend e sai quando waitPoll ve EPOLLOUT; se pend enche, o
+    outro lado nao esta lendo e a conexao e marcada closed.
+*/
+#include "tcpclient.hpp"
+
+#define SEND_PENDING 256    //acks e bytes de desgaste esperando o socket
+
+typedef struct {
+    SOCKET s;
+    void *user;                 //dono da conexao, devolvido junto em waitPoll
+    bool closed;
+    bool send_failed;           //depois de um erro de envio sendData so devolve 1
+    recv_ring_t ring;
+    int pend_len;
+    char pend[SEND_PENDING];
+} tcp_conn_t;
+
+typedef struct {
+    int epfd;
+} tcp_poll_t;
+
+int initPoll(tcp_poll_t *p);
+void closePoll(tcp_poll_t *p);
+int connect(tcp_poll_t *p, tcp_conn_t *c, char const *ip, int port, void *user);
+void closeConn(tcp_poll_t *p, tcp_conn_t *c);
+int addConn(tcp_poll_t *p, tcp_conn_t *c);             //registra uma conexao aberta, edge-triggered
+void removeConn(tcp_poll_t *p, tcp_conn_t *c);          //tira do poll sem fechar, para outro poll adotar com addConn
+//servidor: cada poll escuta a porta com SO_REUSEPORT; l aparece em waitPoll quando ha conexoes,
+//e acceptConn deve ser chamado ate devolver 1
+int listenPoll(tcp_poll_t *p, tcp_conn_t *l, int port);
+int acceptConn(tcp_poll_t *p, tcp_conn_t *l, tcp_conn_t *c, void *user);    //0 se aceitou e registrou c; 1 se nao ha mais
+int sendData(tcp_conn_t *c, char *message);
+int sendData(tcp_conn_t *c, char *message, int size);      //0 se enviou ou guardou em pend
+char *recData(tcp_conn_t *c, int size);    //sem copia, vale ate a proxima chamada; NULL se ainda nao chegaram size bytes
+int waitPoll(tcp_poll_t *p, tcp_conn_t **ready, int max, int timeout_ms);
+
+#endif
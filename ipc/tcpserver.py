@@ -1,8 +1,14 @@
 # server.py 
 import socket
 
+HELLO = b'WP'		#cabecalho do protocolo com janela
+VERSION = 2
+FRAME_MAX = 1024	#amostras por lote aceitas pelo a.exe
+ACK = ord('A')		#'A' + amostras processadas pelo cliente, 32 bits big-endian
+ACK_SIZE = 5
+
 class tcpServer:
-	def __init__(self):
+	def __init__(self, window=4096, ack_every=256, ack_ms=20, frame=256):
 		# create a socket object
 		self.serversocket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
 		# get local machine name
@@ -11,6 +17,14 @@ class tcpServer:
 		# bind to the port
 		self.serversocket.bind((self.host, self.port))
 
+		self.window = window		#amostras enviadas e ainda sem ack
+		self.ack_every = ack_every	#o cliente confirma a cada ack_every amostras,
+		self.ack_ms = ack_ms		#a cada ack_ms ms ou quando esvazia a fila
+		self.frame = min(frame, FRAME_MAX)	#amostras por lote
+		self.sent = 0				#sequencia: amostras enviadas desde a conexao
+		self.acked = 0
+		self.pending = b''			#bytes recebidos ainda sem mensagem completa
+
 
 	def sendData(self, data):
 		self.clientsocket.send(data)
@@ -24,4 +38,49 @@ class tcpServer:
 		print("Listening from socket...")
 		self.serversocket.listen(requests)
 		self.clientsocket, self.addr = self.serversocket.accept()
-		print("Got a connection from %s" % str(self.addr))
\ No newline at end of file
+		print("Got a connection from %s" % str(self.addr))
+		self.clientsocket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+		self.clientsocket.sendall(HELLO + bytes([VERSION, 0]) + self.ack_every.to_bytes(2, 'big') + self.ack_ms.to_bytes(2, 'big'))
+
+	def replay(self, fields):	#uma serie int16 big-endian (bytes) por campo; devolve os bytes de desgaste
+		n = len(fields[0])//2
+		mask = (1 << len(fields)) - 1
+		end = self.sent + n
+		first = self.sent
+		wear = bytearray()
+
+		while self.acked < end:
+			free = self.window - (self.sent - self.acked)
+			if self.sent < end and free > 0:
+				k = min(end - self.sent, free, self.frame)
+				i = self.sent - first
+				self.clientsocket.sendall(self.frameBytes(fields, mask, i, k))
+				self.sent += k
+			else:
+				self.receive(wear)
+
+		return bytes(wear)
+
+	def frameBytes(self, fields, mask, i, k):	#cabecalho e k amostras a partir de i, um campo inteiro apos o outro
+		payload = b''.join(f[2*i:2*(i + k)] for f in fields)
+		return bytes([VERSION, mask]) + k.to_bytes(2, 'big') + len(payload).to_bytes(4, 'big') + payload
+
+	def receive(self, wear):	#le acks e bytes de desgaste do cliente
+		data = self.clientsocket.recv(65536)
+		if not data:
+			raise ConnectionError("Client disconnected.")
+		data = self.pending + data
+		i = 0
+		while i < len(data):
+			if data[i] == ACK:
+				if len(data) - i < ACK_SIZE:
+					break
+				seq = int.from_bytes(data[i+1:i+ACK_SIZE], 'big')
+				self.acked += (seq - self.acked) & 0xFFFFFFFF	#sequencia de 32 bits pode dar a volta
+				i += ACK_SIZE
+			elif data[i] & 0xC0 == 0xC0:
+				wear.append(data[i])
+				i += 1
+			else:
+				raise ValueError("Unexpected byte from client: %02x" % data[i])
+		self.pending = data[i:]
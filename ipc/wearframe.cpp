@@ -0,0 +1,138 @@
+/*
+    Lotes, hellos e acks do protocolo de amostras
+*/
+#include "wearframe.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static uint32_t get32(const unsigned char *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char) (v >> 24);
+    p[1] = (unsigned char) (v >> 16);
+    p[2] = (unsigned char) (v >> 8);
+    p[3] = (unsigned char) v;
+}
+
+bool readFrame(frame_t *f, unsigned char *header)
+{
+    int fields = 0;
+
+    f->mask = header[1];
+    f->count = (header[2] << 8) | header[3];
+    f->length = (int) get32(header + 4);
+    for(int k = 0; k < FIELDS; k++)
+        f->offset[k] = (f->mask & (1 << k))? 2*f->count*fields++: -1;
+
+    return header[0] == PROTOCOL_VERSION && (f->mask >> FIELDS) == 0 && f->count <= FRAME_MAX
+        && f->length == 2*f->count*fields;
+}
+
+void decode(const frame_t *f, unsigned char *payload, int i, short *rpm_engine_value, short *speed, short *brk)  //amostra i do lote; campo ausente vale 0
+{
+    short *out[3] = {rpm_engine_value, speed, brk};
+
+    for(int k = 0; k < FIELDS; k++)
+    {
+        unsigned char *p = payload + 2*i;
+
+        if(f->offset[k] < 0)
+            *out[k] = 0;
+        else
+            *out[k] = (short) ((p[f->offset[k]] << 8) | p[f->offset[k] + 1]);
+    }
+}
+
+void decodeFrame(const frame_t *f, unsigned char *payload, int16_t *rpm, int16_t *spd, int16_t *brk)
+{
+    int16_t *out[3] = {rpm, spd, brk};
+
+    for(int k = 0; k < FIELDS; k++)
+    {
+        unsigned char *p = payload + (f->offset[k] < 0? 0: f->offset[k]);
+
+        for(int i = 0; i < f->count; i++)
+            out[k][i] = (f->offset[k] < 0)? 0: (int16_t) ((p[2*i] << 8) | p[2*i + 1]);
+    }
+}
+
+void writeHello(unsigned char out[], const wear_ack_t *a)
+{
+    out[0] = 'W';
+    out[1] = 'P';
+    out[2] = PROTOCOL_VERSION;
+    out[3] = 0;
+    out[4] = (unsigned char) (a->ack_every >> 8);
+    out[5] = (unsigned char) a->ack_every;
+    out[6] = (unsigned char) (a->ack_ms >> 8);
+    out[7] = (unsigned char) a->ack_ms;
+}
+
+bool readHello(wear_ack_t *a, unsigned char *msg)
+{
+    if(msg[0] != 'W' || msg[1] != 'P' || msg[2] != PROTOCOL_VERSION)
+        return false;
+    initAck(a, (msg[4] << 8) | msg[5], (msg[6] << 8) | msg[7]);
+    return true;
+}
+
+void writeVehicleHello(unsigned char out[], uint32_t id)
+{
+    out[0] = 'W';
+    out[1] = 'V';
+    out[2] = PROTOCOL_VERSION;
+    out[3] = 0;
+    put32(out + 4, id);
+}
+
+bool readVehicleHello(unsigned char *msg, uint32_t *id)
+{
+    if(msg[0] != 'W' || msg[1] != 'V' || msg[2] != PROTOCOL_VERSION)
+        return false;
+    *id = get32(msg + 4);
+    return true;
+}
+
+void initAck(wear_ack_t *a, unsigned short ack_every, unsigned short ack_ms)
+{
+    a->ack_every = ack_every;
+    a->ack_ms = ack_ms;
+    a->seq = a->acked = 0;
+    a->last_ack = nowMs();
+}
+
+int ackMessage(wear_ack_t *a, bool idle, unsigned char out[])
+{
+    unsigned long pending = a->seq - a->acked;
+
+    if(pending == 0)
+        return 0;
+    //a cada ack_every amostras, a cada ack_ms ou quando a fila esvaziou
+    if(!idle && pending < a->ack_every && (a->ack_ms == 0 || nowMs() - a->last_ack < a->ack_ms))
+        return 0;
+
+    a->acked = a->seq;
+    a->last_ack = nowMs();
+    out[0] = 'A';
+    put32(out + 1, (uint32_t) a->seq);
+    return ACK_SIZE;
+}
+
+unsigned long nowMs()
+{
+#ifdef _WIN32
+    return GetTickCount();
+#else
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec*1000UL + t.tv_nsec/1000000;
+#endif
+}
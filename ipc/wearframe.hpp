@@ -0,0 +1,50 @@
+#ifndef WEARFRAME
+#define WEARFRAME
+
+/*
+    Protocolo das amostras por TCP, o mesmo no a.exe e no server/wear_server.
+    Quem recebe as amostras abre com um hello e devolve acks cumulativos e o
+    byte de desgaste de cada janela; quem envia manda lotes e mantem ate uma
+    janela de amostras sem ack.
+
+    hello de quem recebe:   'W' 'P' versao 0, ack_every e ack_ms 16 bits
+    hello do veiculo:       'W' 'V' versao 0, id 32 bits (so no wear_server)
+    lote:                   versao, mascara, amostras 16 bits, bytes do payload 32 bits
+                            e cada campo presente inteiro, um apos o outro
+    ack:                    'A' e o total de amostras processadas, 32 bits
+    desgaste:               o byte da janela com os 2 bits altos em 1
+
+    Tudo big-endian.
+*/
+#include <stdint.h>
+
+const int HELLO_SIZE = 8;
+const int FRAME_HEADER = 8;
+const int FRAME_MAX = 1024;         //amostras por lote
+const int FIELDS = 3;               //rpm, velocidade e freio, bits 0..2 da mascara
+const int ACK_SIZE = 5;
+const unsigned char PROTOCOL_VERSION = 2;
+
+typedef struct {    //lote de amostras
+    int count, mask, length;
+    int offset[3];  //inicio de cada campo no payload, -1 se o campo nao veio
+} frame_t;
+
+typedef struct {    //lado que recebe: quando confirmar
+    unsigned short ack_every, ack_ms;
+    unsigned long seq, acked;       //amostras processadas e ja confirmadas
+    unsigned long last_ack;         //ms do ultimo ack
+} wear_ack_t;
+
+bool readFrame(frame_t *f, unsigned char *header);     //false se a versao, a mascara ou o tamanho nao batem
+void decode(const frame_t *f, unsigned char *payload, int i, short *rpm_engine_value, short *speed, short *brk);
+void decodeFrame(const frame_t *f, unsigned char *payload, int16_t *rpm, int16_t *spd, int16_t *brk);  //lote inteiro
+void writeHello(unsigned char out[], const wear_ack_t *a);
+bool readHello(wear_ack_t *a, unsigned char *msg);      //false se nao e o protocolo com janela
+void writeVehicleHello(unsigned char out[], uint32_t id);
+bool readVehicleHello(unsigned char *msg, uint32_t *id);
+void initAck(wear_ack_t *a, unsigned short ack_every, unsigned short ack_ms);
+int ackMessage(wear_ack_t *a, bool idle, unsigned char out[]);    //tamanho do ack a enviar, 0 se ainda nao e hora
+unsigned long nowMs();
+
+#endif
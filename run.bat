@@ -1,4 +1,4 @@
-g++ .\sketchSimu.cpp .\ipc\tcpclient.cpp .\sketch\abrasion.c -lws2_32 || goto :error
+g++ -O2 -march=native .\sketchSimu.cpp .\ipc\tcpclient.cpp .\ipc\wearframe.cpp .\sketch\abrasion.c .\sketch\abrasion_batch.c .\sketch\wear_slide.c .\sketch\wear_report.c .\sketch\wear_rollup.c .\sketch\wear_quantile.c .\sketch\wear_trip.c .\sketch\wear_component.c .\sketch\wear_multi.c .\sketch\wear_snapshot.c .\sketch\wear_profile.c -lws2_32 || goto :error
 
 CALL activate env
 START python db-serial.py %*
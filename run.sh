@@ -0,0 +1,8 @@
+#!/bin/sh
+# equivalente ao run.bat no Linux; o simulador vira ./sketchSimu
+cd "$(dirname "$0")" || exit 1
+g++ -O2 -march=native -o sketchSimu sketchSimu.cpp ipc/tcpclient.cpp ipc/tcppoll.cpp ipc/wearframe.cpp sketch/abrasion.c sketch/abrasion_batch.c sketch/wear_slide.c sketch/wear_report.c sketch/wear_rollup.c sketch/wear_quantile.c sketch/wear_trip.c sketch/wear_component.c sketch/wear_multi.c sketch/wear_snapshot.c sketch/wear_profile.c || { echo "Compilation error."; exit 1; }
+
+python db-serial.py "$@" &
+sleep 10
+./sketchSimu
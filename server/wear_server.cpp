@@ -0,0 +1,411 @@
+/*
+ * Servidor de desgaste para frotas (Linux). Cada veiculo conecta na porta, se
+ * identifica com o hello 'W' 'V' e manda as amostras em lotes, no protocolo de
+ * ipc/wearframe.hpp; o servidor confirma com acks cumulativos e devolve o byte
+ * de desgaste de cada janela, como o a.exe.
+ *
+ * Um loop epoll por nucleo, cada um escutando a porta com SO_REUSEPORT. Quem
+ * aceita a conexao so le o hello; depois ela passa para a thread dona do
+ * veiculo (id % threads), que guarda o wear_ctx_t dele entre reconexoes. Um
+ * veiculo cai sempre na mesma thread e nenhum contexto e compartilhado; a
+ * janela parcial continua na reconexao. As janelas fechadas vao para uma
+ * saida unica, em blocos de linhas inteiras por thread:
+ *   {vehicle: 12, window: 3, brake: 1, clutch: 0, engine: 2},
+ *
+ * uso: wear_server [-p porta] [-j threads] [-w janela] [-a ack_every] [-t ack_ms] [-o saida.txt]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "tcppoll.hpp"
+#include "wearframe.hpp"
+#include "abrasion.h"
+
+#define RING_SIZE	16384	//buffer de recepcao por conexao
+#define OUT_BUF		65536	//linhas de cada thread antes de ir para a saida
+#define LINE_LEN	96
+#define EVENTS		64
+
+WEAR_STATIC_ASSERT(frame_fits, 2*(FRAME_HEADER + 2*FIELDS*FRAME_MAX) <= RING_SIZE);
+
+typedef struct {	//estado de um veiculo, so na thread dona
+	uint32_t id;
+	wear_ctx_t ctx;
+	size_t fill;			//amostras da janela atual
+	unsigned long windows;
+	char online;			//uma conexao por veiculo
+} vehicle_t;
+
+struct shard;
+
+typedef struct conn {
+	tcp_conn_t tcp;
+	uint32_t id;
+	vehicle_t *v;			//NULL ate o hello
+	wear_ack_t ack;
+	frame_t frame;			//cabecalho ja lido, esperando o payload
+	char framed;
+	char bad;				//erro de protocolo: fecha sem ler o resto
+	struct conn *next;		//fila de passagem entre threads
+} conn_t;
+
+typedef struct shard {
+	int index;
+	pthread_t thread;
+	tcp_poll_t poll;
+	tcp_conn_t listener;
+	tcp_conn_t wake;		//eventfd: chegou conexao na fila
+	pthread_mutex_t lock;	//protege inbox
+	conn_t *inbox;
+	vehicle_t **table;		//enderecamento aberto por id
+	size_t cap, count;
+	char out[OUT_BUF];
+	size_t out_len;
+	unsigned long long conns, samples, windows;
+} shard_t;
+
+typedef struct {	//saida compartilhada
+	FILE *f;
+	pthread_mutex_t lock;
+} sink_t;
+
+static shard_t *shards;
+static int n_shards;
+static size_t window = 1024;
+static unsigned short ack_every = 256, ack_ms = 20;
+static sink_t sink;
+static volatile sig_atomic_t stop = 0;
+
+
+static void onSignal(int sig) {
+	(void) sig;
+	stop = 1;
+}
+
+
+static size_t hashId(uint32_t id) {	//os ids de uma thread tem o mesmo resto, entao mistura antes da mascara
+	id ^= id >> 16;
+	id *= 0x45d9f3bu;
+	id ^= id >> 16;
+	return id;
+}
+
+
+static vehicle_t *findVehicle(shard_t *sh, uint32_t id) {	//cria na primeira conexao
+	size_t i;
+
+	if (2*(sh->count + 1) > sh->cap) {
+		size_t cap = sh->cap? 2*sh->cap: 256;
+		vehicle_t **table = (vehicle_t **) calloc(cap, sizeof(vehicle_t *));
+
+		if (table == NULL)
+			return NULL;
+		for (size_t j = 0; j < sh->cap; j++) {
+			if (sh->table[j] == NULL)
+				continue;
+			for (i = hashId(sh->table[j]->id) & (cap - 1); table[i] != NULL; i = (i + 1) & (cap - 1));
+			table[i] = sh->table[j];
+		}
+		free(sh->table);
+		sh->table = table;
+		sh->cap = cap;
+	}
+
+	for (i = hashId(id) & (sh->cap - 1); sh->table[i] != NULL; i = (i + 1) & (sh->cap - 1)) {
+		if (sh->table[i]->id == id)
+			return sh->table[i];
+	}
+	vehicle_t *v = (vehicle_t *) calloc(1, sizeof(vehicle_t));
+	if (v == NULL)
+		return NULL;
+	v->id = id;
+	initWear(&v->ctx);
+	sh->table[i] = v;
+	sh->count++;
+	return v;
+}
+
+
+static void flushOut(shard_t *sh) {
+	if (sh->out_len == 0)
+		return;
+	pthread_mutex_lock(&sink.lock);
+	fwrite(sh->out, 1, sh->out_len, sink.f);
+	fflush(sink.f);
+	pthread_mutex_unlock(&sink.lock);
+	sh->out_len = 0;
+}
+
+
+static void closeWindow(shard_t *sh, conn_t *cn) {
+	vehicle_t *v = cn->v;
+	unsigned char d[2];
+
+	wearDataCtx(&v->ctx, d);
+	resetWearCtx(&v->ctx, 4);
+	v->fill = 0;
+
+	if (sh->out_len + LINE_LEN > OUT_BUF)
+		flushOut(sh);
+	sh->out_len += snprintf(sh->out + sh->out_len, LINE_LEN, "{vehicle: %u, window: %lu, brake: %u, clutch: %u, engine: %u},\n",
+		v->id, v->windows, d[0]>>4, (d[0]>>2) & 0x3, d[0] & 0x3);
+	v->windows++;
+	sh->windows++;
+
+	d[0] |= 0xC0;	//mesmo byte que o a.exe envia
+	sendData(&cn->tcp, (char *) d, 1);
+}
+
+
+static void onFrame(shard_t *sh, conn_t *cn, unsigned char *payload) {
+	int16_t rpm[FRAME_MAX], spd[FRAME_MAX], brk[FRAME_MAX];
+	vehicle_t *v = cn->v;
+	size_t n = cn->frame.count, i = 0;
+
+	decodeFrame(&cn->frame, payload, rpm, spd, brk);
+	while (i < n) {	//o lote passa inteiro por accumulateWearBatch, cortado so onde a janela fecha
+		size_t k = (n - i < window - v->fill)? n - i: window - v->fill;
+
+		accumulateWearBatch(&v->ctx, rpm + i, spd + i, brk + i, k);
+		v->fill += k;
+		i += k;
+		if (v->fill == window)
+			closeWindow(sh, cn);
+	}
+	cn->ack.seq += n;
+	sh->samples += n;
+}
+
+
+static void dropConn(shard_t *sh, conn_t *cn) {
+	closeConn(&sh->poll, &cn->tcp);
+	if (cn->v != NULL)
+		cn->v->online = 0;	//a janela parcial fica para a proxima conexao
+	free(cn->tcp.ring.buf);
+	free(cn);
+}
+
+
+static char attachVehicle(shard_t *sh, conn_t *cn) {	//0 se o veiculo ja tem conexao ou faltou memoria
+	unsigned char hello[HELLO_SIZE];
+	vehicle_t *v = findVehicle(sh, cn->id);
+
+	if (v == NULL) {
+		fprintf(stderr, "Sem memoria para o veiculo %u, recusando.\n", cn->id);
+		return 0;
+	}
+	if (v->online) {
+		fprintf(stderr, "Veiculo %u ja conectado, recusando.\n", cn->id);
+		return 0;
+	}
+	v->online = 1;
+	cn->v = v;
+	initAck(&cn->ack, ack_every, ack_ms);
+	writeHello(hello, &cn->ack);
+	sendData(&cn->tcp, (char *) hello, HELLO_SIZE);
+	return 1;
+}
+
+
+static void handOff(shard_t *from, conn_t *cn) {
+	shard_t *to = &shards[cn->id % n_shards];
+	uint64_t one = 1;
+
+	removeConn(&from->poll, &cn->tcp);
+	pthread_mutex_lock(&to->lock);
+	cn->next = to->inbox;
+	to->inbox = cn;
+	pthread_mutex_unlock(&to->lock);
+	if (write(to->wake.s, &one, sizeof(one)) < 0)
+		perror("eventfd");
+}
+
+
+static void serveConn(shard_t *sh, conn_t *cn) {	//consome o que chegou, ate recData devolver NULL
+	unsigned char *msg, ack[ACK_SIZE];
+	int len;
+
+	//o FIN pode chegar junto com os ultimos lotes: closed so vale depois de esvaziar o anel
+	while (!cn->bad && (msg = (unsigned char *) recData(&cn->tcp, cn->v == NULL? HELLO_SIZE: cn->framed? cn->frame.length: FRAME_HEADER)) != NULL) {
+		if (cn->v == NULL) {
+			if (!readVehicleHello(msg, &cn->id)) {
+				cn->bad = 1;
+			} else if (&shards[cn->id % n_shards] != sh) {
+				handOff(sh, cn);	//o resto ja lido vai junto no anel
+				return;
+			} else if (!attachVehicle(sh, cn)) {
+				cn->bad = 1;
+			}
+			continue;
+		}
+		if (!cn->framed) {
+			if (!(cn->framed = readFrame(&cn->frame, msg)))
+				cn->bad = 1;
+			continue;
+		}
+		cn->framed = 0;
+		onFrame(sh, cn, msg);
+		if ((len = ackMessage(&cn->ack, false, ack)) > 0)
+			sendData(&cn->tcp, (char *) ack, len);
+	}
+	if (cn->bad || cn->tcp.closed) {
+		dropConn(sh, cn);
+		return;
+	}
+	if (cn->v != NULL && (len = ackMessage(&cn->ack, true, ack)) > 0)	//leu tudo o que havia
+		sendData(&cn->tcp, (char *) ack, len);
+}
+
+
+static void acceptAll(shard_t *sh) {
+	while (true) {
+		conn_t *cn = (conn_t *) calloc(1, sizeof(conn_t));
+		char *ring = (char *) aligned_alloc(RECV_RING_ALIGN, RING_SIZE);
+
+		if (cn == NULL || ring == NULL) {
+			free(cn);
+			free(ring);
+			return;
+		}
+		initRecvRing(&cn->tcp.ring, ring, RING_SIZE);
+		if (acceptConn(&sh->poll, &sh->listener, &cn->tcp, cn) != 0) {
+			free(ring);
+			free(cn);
+			return;
+		}
+		sh->conns++;
+	}
+}
+
+
+static void adoptAll(shard_t *sh) {	//conexoes aceitas por outras threads para veiculos desta
+	uint64_t count;
+	conn_t *list;
+
+	if (read(sh->wake.s, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		perror("eventfd");
+	pthread_mutex_lock(&sh->lock);
+	list = sh->inbox;
+	sh->inbox = NULL;
+	pthread_mutex_unlock(&sh->lock);
+
+	while (list != NULL) {
+		conn_t *cn = list;
+
+		list = cn->next;
+		if (addConn(&sh->poll, &cn->tcp) != 0 || !attachVehicle(sh, cn)) {
+			dropConn(sh, cn);
+			continue;
+		}
+		serveConn(sh, cn);	//o que ja estava no anel nao gera evento
+	}
+}
+
+
+static void *runShard(void *arg) {
+	shard_t *sh = (shard_t *) arg;
+	tcp_conn_t *ready[EVENTS];
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(sh->index % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+	while (!stop) {
+		int n = waitPoll(&sh->poll, ready, EVENTS, 200);
+
+		for (int i = 0; i < n; i++) {
+			if (ready[i] == &sh->listener)
+				acceptAll(sh);
+			else if (ready[i] == &sh->wake)
+				adoptAll(sh);
+			else
+				serveConn(sh, (conn_t *) ready[i]->user);
+		}
+		flushOut(sh);
+	}
+	return NULL;
+}
+
+
+static int initShard(shard_t *sh, int index, int port) {
+	memset(sh, 0, sizeof(*sh));
+	sh->index = index;
+	pthread_mutex_init(&sh->lock, NULL);
+	if (initPoll(&sh->poll) != 0 || listenPoll(&sh->poll, &sh->listener, port) != 0)
+		return 1;
+	sh->wake.s = eventfd(0, EFD_NONBLOCK);
+	return (sh->wake.s < 0 || addConn(&sh->poll, &sh->wake) != 0)? 1: 0;
+}
+
+
+int main(int argc, char *argv[]) {
+	const char *out_path = NULL;
+	int port = 5000, opt;
+	unsigned long long conns = 0, samples = 0, windows = 0, vehicles = 0;
+	struct sigaction sa;
+
+	n_shards = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	while ((opt = getopt(argc, argv, "p:j:w:a:t:o:")) != -1) {
+		switch (opt) {
+			case 'p': port = atoi(optarg); break;
+			case 'j': n_shards = atoi(optarg); break;
+			case 'w': window = (size_t) atol(optarg); break;
+			case 'a': ack_every = (unsigned short) atoi(optarg); break;
+			case 't': ack_ms = (unsigned short) atoi(optarg); break;
+			case 'o': out_path = optarg; break;
+			default:
+				fprintf(stderr, "uso: %s [-p porta] [-j threads] [-w janela] [-a ack_every] [-t ack_ms] [-o saida.txt]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (n_shards < 1 || window == 0) {
+		fprintf(stderr, "threads e janela devem ser maiores que 0\n");
+		return 1;
+	}
+
+	sink.f = (out_path != NULL)? fopen(out_path, "w"): stdout;
+	if (sink.f == NULL) {
+		perror(out_path);
+		return 1;
+	}
+	pthread_mutex_init(&sink.lock, NULL);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	shards = (shard_t *) calloc(n_shards, sizeof(shard_t));
+	if (shards == NULL)
+		return 1;
+	for (int i = 0; i < n_shards; i++) {
+		if (initShard(&shards[i], i, port) != 0) {
+			fprintf(stderr, "nao foi possivel escutar a porta %d\n", port);
+			return 1;
+		}
+	}
+	fprintf(stderr, "Escutando a porta %d com %d threads, janela de %zu amostras.\n", port, n_shards, window);
+	for (int i = 0; i < n_shards; i++)
+		pthread_create(&shards[i].thread, NULL, runShard, &shards[i]);
+
+	for (int i = 0; i < n_shards; i++) {
+		pthread_join(shards[i].thread, NULL);
+		flushOut(&shards[i]);
+		conns += shards[i].conns;
+		samples += shards[i].samples;
+		windows += shards[i].windows;
+		vehicles += shards[i].count;
+	}
+	fprintf(stderr, "%llu conexoes, %llu veiculos, %llu amostras, %llu janelas\n", conns, vehicles, samples, windows);
+	if (sink.f != stdout)
+		fclose(sink.f);
+	return 0;
+}
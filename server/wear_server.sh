@@ -0,0 +1,6 @@
+#!/bin/sh
+# compila e roda o servidor de desgaste (Linux)
+# uso: server/wear_server.sh [-p porta] [-j threads] [-w janela] [-a ack_every] [-t ack_ms] [-o saida.txt]
+root="$(dirname "$0")/.."
+g++ -O2 -march=native -pthread -I "$root/sketch" -I "$root/ipc" -o "$root/server/wear_server" "$root/server/wear_server.cpp" "$root/ipc/tcpclient.cpp" "$root/ipc/tcppoll.cpp" "$root/ipc/wearframe.cpp" "$root"/sketch/*.c || exit 1
+"$root/server/wear_server" "$@"
@@ -4,13 +4,14 @@ from ipc.tcpserver import tcpServer
 FAIL = False
 
 def Init(ARGS):
-	global DEBUG, SERIAL, TCP, SAVEFIG, DSETPLOT
+	global DEBUG, SERIAL, TCP, SAVEFIG, DSETPLOT, NATIVE
 
 	DEBUG = False
 	SERIAL = False
 	TCP = False
 	SAVEFIG = False
 	DSETPLOT = False
+	NATIVE = False
 
 	args = sys.argv[1:]	#captura os parametros para execucao
 
@@ -25,10 +26,15 @@ def Init(ARGS):
 			SAVEFIG = True
 		elif(a == ARGS[4]):
 			DSETPLOT = True
+		elif(len(ARGS) > 5 and a == ARGS[5]):
+			NATIVE = True
 
 	if(SERIAL and TCP):
 		print("Can't send through serial and tcp at the same time.")
 		return False
+	elif(NATIVE and (SERIAL or TCP)):
+		print("Can't use the native engine and a device at the same time.")
+		return False
 	else:
 		return True
 
@@ -41,6 +47,10 @@ def configEnvoirement(_config_file):
 	boud_rate = int(data["serial_boud_rate"])
 	port = str(data["serial_port"])
 	timeout = float(data["serial_timeout"])
+	window = int(data.get("tcp_window", 4096))		#amostras em voo sem ack
+	ack_every = int(data.get("tcp_ack_every", 256))
+	ack_ms = int(data.get("tcp_ack_ms", 20))
+	frame = int(data.get("tcp_frame", 256))			#amostras por lote
 
 	_logs_path = data["logs_path"]
 	_log_names = data["log_names"]
@@ -81,9 +91,9 @@ def configEnvoirement(_config_file):
 	#inicializa conexao tcp		
 	elif(TCP):
 		print("Strating tcp connection.")
-		socket = tcpServer()
+		socket = tcpServer(window, ack_every, ack_ms, frame)
 		socket.listen(1)
-		return socket, _logs_path, _log_names, _log_files, _variables, sendTCPData, getTCPData
+		return socket, _logs_path, _log_names, _log_files, _variables, replayTCPData, None
 
 	#nao retorna nenhum dispotivivo conectado
 	else:
@@ -133,10 +143,5 @@ def restartSerial(arduino):
 	return
 
 
-def sendTCPData(socket, data):
-	socket.sendData(data);
-	return
-
-def getTCPData(socket):
-	data = socket.receiveData(2)
-	return data
\ No newline at end of file
+def replayTCPData(socket, fields):	#todas as amostras de uma vez, em lotes e com janela; bytes de desgaste na ordem
+	return socket.replay(fields)
\ No newline at end of file
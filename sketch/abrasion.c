@@ -1,32 +1,68 @@
 #include "abrasion.h"
-
-short RPM_THRESHOLD[] = {1500, 2500, 3500};
-short SPD_THRESHOLD[] = {6, 13, 20};
-short BRK_THRESHOLD[] = {1000, 2000, 3000};
-
-short RPM_RATE_THRESHOLD[] = {15, 30, 45};
-short BRK_RATE_THRESHOLD[] = {16, 32, 64};
-
-char BRAKE_WEAR[16]	= {	0x0, 0x0, 0x1, 0x2, 
-						0x0, 0x1, 0x1, 0x2, 
-						0x0, 0x1, 0x2, 0x3, 
-						0x0, 0x1, 0x2, 0x3};
-
-char CLUTCH_WEAR[8]	= {	0x0, 0x0, 
-						0x1, 0x0, 
-						0x2, 0x0, 
-						0x3, 0x0};
-
-char ENGINE_WEAR[16] = {0x0, 0x0, 0x0, 0x0,
-						0x0, 0x0, 0x1, 0x1,
-						0x0, 0x1, 0x1, 0x2,
-						0x1, 0x2, 0x2, 0x3};
-
-short CUMULATIVE_BRAKE[] = {0, 0, 0, 0};
-short CUMULATIVE_CLUTCH[] = {0, 0, 0, 0};
-short CUMULATIVE_RPM[] = {0, 0, 0, 0};
-
-short last_brk, last_rpm;
+#include "wear_quantile.h"
+#if WEAR_USE_LUT
+#include "wear_lut.h"
+#endif
+
+// um ponteiro publicado e consumido inteiro; no AVR o ponteiro tem 2 bytes e
+// so desligando interrupcoes
+#if defined(__AVR__)
+#include <util/atomic.h>
+#define PROFILE_PUBLISH(dst, p)		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { (dst) = (p); }
+#define PROFILE_PEEK(src)			(src)
+#define PROFILE_TAKE(dst, src)		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { (dst) = (src); (src) = NULL; }
+#else
+#define PROFILE_PUBLISH(dst, p)		__atomic_store_n(&(dst), (p), __ATOMIC_RELEASE)
+#define PROFILE_PEEK(src)			__atomic_load_n(&(src), __ATOMIC_RELAXED)
+#define PROFILE_TAKE(dst, src)		(dst) = __atomic_exchange_n(&(src), (const wear_profile_t *) NULL, __ATOMIC_ACQUIRE)
+#endif
+
+const short BRK_THRESHOLD[] = {BRK_T0, BRK_T1, BRK_T2};
+
+#if WEAR_USE_LUT
+#define RPM_CLASS(v)		lutClass(RPM_LUT, (v), RPM_T0, RPM_LUT_SIZE)
+#define SPD_CLASS(v)		lutClass(SPD_LUT, (v), SPD_T0, SPD_LUT_SIZE)
+#define RPM_RATE_CLASS(dx)	lutClass(RPM_RATE_LUT, (dx), RPM_RATE_T0, RPM_RATE_LUT_SIZE)
+#define BRK_RATE_CLASS(dx)	lutClass(BRK_RATE_LUT, (dx), BRK_RATE_T0, BRK_RATE_LUT_SIZE)
+#else
+#define RPM_CLASS(v)		discretize((v), RPM_THRESHOLD, 3)
+#define SPD_CLASS(v)		discretize((v), SPD_THRESHOLD, 3)
+#define RPM_RATE_CLASS(dx)	rate(0, (dx), RPM_RATE_THRESHOLD)
+#define BRK_RATE_CLASS(dx)	rate(0, (dx), BRK_RATE_THRESHOLD)
+#endif
+
+#define BRAKE_WEAR_TABLE	{	0x0, 0x0, 0x1, 0x2, \
+								0x0, 0x1, 0x1, 0x2, \
+								0x0, 0x1, 0x2, 0x3, \
+								0x0, 0x1, 0x2, 0x3}
+
+#define CLUTCH_WEAR_TABLE	{	0x0, 0x0, \
+								0x1, 0x0, \
+								0x2, 0x0, \
+								0x3, 0x0}
+
+#define ENGINE_WEAR_TABLE	{	0x0, 0x0, 0x0, 0x0, \
+								0x0, 0x0, 0x1, 0x1, \
+								0x0, 0x1, 0x1, 0x2, \
+								0x1, 0x2, 0x2, 0x3}
+
+const wear_profile_t WEAR_DEFAULT_PROFILE = {
+	{RPM_T0, RPM_T1, RPM_T2}, {SPD_T0, SPD_T1, SPD_T2},
+	{RPM_RATE_T0, RPM_RATE_T1, RPM_RATE_T2}, {BRK_RATE_T0, BRK_RATE_T1, BRK_RATE_T2},
+	{0, 0, 0, 0}, {0, 1, 5, 8}, {0, 1, 5, 8},
+	BRAKE_WEAR_TABLE, CLUTCH_WEAR_TABLE, ENGINE_WEAR_TABLE
+};
+
+// tabela com tamanho diferente do que os campos enderecam nao compila; no perfil
+// uma tabela curta seria completada com zeros, por isso o tamanho vem das copias
+static const char brake_wear_table[] = BRAKE_WEAR_TABLE;
+static const char clutch_wear_table[] = CLUTCH_WEAR_TABLE;
+static const char engine_wear_table[] = ENGINE_WEAR_TABLE;
+WEAR_STATIC_ASSERT(brake_wear_len, sizeof(brake_wear_table) == BRAKE_WEAR_LEN);
+WEAR_STATIC_ASSERT(clutch_wear_len, sizeof(clutch_wear_table) == CLUTCH_WEAR_LEN);
+WEAR_STATIC_ASSERT(engine_wear_len, sizeof(engine_wear_table) == ENGINE_WEAR_LEN);
+
+static wear_ctx_t DEFAULT_WEAR;	//contexto usado pela API de um unico veiculo
 
 
 void printhex(short *buf, char size)
@@ -44,7 +80,7 @@ void printhex(short *buf, char size)
 }
 
 
-char discretize(short value, short thresh[], char len) {
+char discretize(short value, const short thresh[], char len) {
 	char out;
 
 	for (out = 0; out < len; out++) {
@@ -57,7 +93,7 @@ char discretize(short value, short thresh[], char len) {
 }
 
 
-char verifyWear(char param[], char param_bits[], char n_param, char wear[]) {
+char verifyWear(char param[], char param_bits[], char n_param, const char wear[]) {
 	char i, in = 0;
 
 	for (i = 0; i < n_param; i++) {
@@ -68,53 +104,254 @@ char verifyWear(char param[], char param_bits[], char n_param, char wear[]) {
 }
 
 
-char rate(short x1, short x2, short vect[]) {
+char rate(short x1, short x2, const short vect[]) {
 	char dx = discretize(x2-x1, vect, 3);
 
 	return (dx >= 0)? dx: 0;
 }
 
 
-void accumulateWear(short rpm, short spd, short brk) {	//acumula valores de desgaste
-	char speed, has_brake, brake_rate, rpm_rate;
-	char brake_vars_bits[] = {2, 2};
-	char clutch_vars_bits[] = {2, 1};
+void initWear(wear_ctx_t *ctx) {
+	resetWearCtx(ctx, 4);
+	ctx->last_brk = 0;
+	ctx->last_rpm = 0;
+	ctx->last_t_us = 0;
+	ctx->has_t = 0;
+	ctx->quant = NULL;
+	ctx->profile = NULL;
+	ctx->next_profile = NULL;
+	setWearEvents(ctx, NULL, NULL, 0);
 
-	//printf("rpm: %d\nspd: %d\nbrk: %d\n", rpm, spd, brk);
+	return;
+}
+
+
+static char increasing(const short t[]) {
+	return t[0] < t[1] && t[1] < t[2];
+}
+
+
+// char e sem sinal no ARM: compara a faixa sem sinal, assim -1 (255) tambem e recusado
+static char validClasses(const char table[], int len) {
+	for (int i = 0; i < len; i++) {
+		if ((unsigned char) table[i] > 3)
+			return 0;
+	}
+	return 1;
+}
+
+
+static char validWeights(const char weight[]) {	//average desloca por weight, ate a largura de wear_wide_t
+	for (int i = 0; i < 4; i++) {
+		if ((unsigned char) weight[i] >= 8*sizeof(wear_wide_t))
+			return 0;
+	}
+	return 1;
+}
+
+
+char checkWearProfile(const wear_profile_t *p) {
+	return increasing(p->rpm) && increasing(p->spd) && increasing(p->rpm_rate) && increasing(p->brk_rate)
+		&& validWeights(p->rpm_weight) && validWeights(p->brake_weight) && validWeights(p->clutch_weight)
+		&& validClasses(p->brake_wear, BRAKE_WEAR_LEN) && validClasses(p->clutch_wear, CLUTCH_WEAR_LEN)
+		&& validClasses(p->engine_wear, ENGINE_WEAR_LEN);
+}
+
+
+void setWearProfile(wear_ctx_t *ctx, const wear_profile_t *p) {	//p deve passar em checkWearProfile
+	ctx->profile = p;
+}
+
+
+void requestWearProfile(wear_ctx_t *ctx, const wear_profile_t *p) {	//p deve passar em checkWearProfile
+	PROFILE_PUBLISH(ctx->next_profile, p);
+}
+
+
+char swapWearProfile(wear_ctx_t *ctx) {	//uma leitura por janela quando nao ha pedido
+	const wear_profile_t *p;
+
+	if (PROFILE_PEEK(ctx->next_profile) == NULL)
+		return 0;
+	PROFILE_TAKE(p, ctx->next_profile);
+	if (p == NULL)
+		return 0;
+	ctx->profile = p;
+	return 1;
+}
+
+
+void setWearEvents(wear_ctx_t *ctx, wear_event_cb_t cb, void *user, short jerk_limit) {
+	ctx->on_event = cb;
+	ctx->event_user = user;
+	ctx->jerk_limit = jerk_limit;
+	ctx->last_spd = 0;
+	ctx->last_acc = 0;
+	ctx->spd_seen = 0;
+	ctx->event_state = 0;
+}
+
+
+static void raiseEvent(wear_ctx_t *ctx, char type, char active, short value, unsigned char cls) {	//so na borda de subida
+	char bit = 1 << type;
+
+	if (active && !(ctx->event_state & bit)) {
+		wear_event_t ev;
 
-	speed = discretize(spd, SPD_THRESHOLD, 3);
-	brake_rate = rate(last_brk, brk, BRK_RATE_THRESHOLD);
-	rpm_rate = rate(last_rpm, rpm, RPM_RATE_THRESHOLD);
+		ev.type = type;
+		ev.value = value;
+		ev.cls = cls;
+		ctx->on_event(ctx->event_user, &ev);
+	}
+	ctx->event_state = active? (ctx->event_state | bit): (ctx->event_state & ~bit);
+}
+
+
+static short scaleDelta(short dx, uint32_t dt_us) {	//variacao por WEAR_RATE_PERIOD_US, arredondada
+	int64_t num = (int64_t) dx * WEAR_RATE_PERIOD_US;
+	int64_t half = dt_us / 2;
+
+	num = (num < 0)? (num - half) / (int64_t) dt_us: (num + half) / (int64_t) dt_us;
+	return (num > 32767)? 32767: (num < -32768)? -32768: (short) num;
+}
+
+
+// dt_us: intervalo real desde a amostra anterior, 0 no periodo nominal. Aceleracao e
+// jerk vao para unidades por WEAR_RATE_PERIOD_US, como as taxas, antes de jerk_limit
+static void checkEvents(wear_ctx_t *ctx, uint32_t dt_us, short spd, char brake_rate, char rpm_rate, short d_rpm, short d_brk, unsigned char cls) {
+	short acc = spd - ctx->last_spd;
+	short jerk;
+
+	if (dt_us != 0)
+		acc = scaleDelta(acc, dt_us);
+	jerk = acc - ctx->last_acc;
+	if (dt_us != 0)
+		jerk = scaleDelta(jerk, dt_us);
+
+	char harsh_jerk = ctx->jerk_limit > 0 && ctx->spd_seen == 2 && (jerk > ctx->jerk_limit || jerk < -ctx->jerk_limit);
+
+	raiseEvent(ctx, WEAR_EVENT_BRAKE, brake_rate == WEAR_TOP_CLASS, d_brk, cls);
+	raiseEvent(ctx, WEAR_EVENT_RPM, rpm_rate == WEAR_TOP_CLASS, d_rpm, cls);
+	raiseEvent(ctx, WEAR_EVENT_JERK, harsh_jerk, jerk, cls);
+
+	ctx->last_spd = spd;
+	ctx->last_acc = (ctx->spd_seen > 0)? acc: 0;
+	ctx->spd_seen += (ctx->spd_seen < 2);
+}
+
+
+// indices combinados da amostra; o perfil padrao usa as macros (e as tabelas de wear_lut.h)
+static inline void rawIndex(const wear_profile_t *p, short rpm, short spd, short brk, short d_rpm, short d_brk,
+		char *speed, char *brake_rate, char *rpm_rate, unsigned char raw[3]) {
+	char has_brake = (brk > BRK_ON_THRESHOLD)? 1: 0;
+
+	if (p == &WEAR_DEFAULT_PROFILE) {
+		*speed = SPD_CLASS(spd);
+		*brake_rate = BRK_RATE_CLASS(d_brk);
+		*rpm_rate = RPM_RATE_CLASS(d_rpm);
+		raw[2] = RPM_CLASS(rpm);
+	} else {
+		*speed = discretize(spd, p->spd, 3);
+		*brake_rate = discretize(d_brk, p->brk_rate, 3);
+		*rpm_rate = discretize(d_rpm, p->rpm_rate, 3);
+		raw[2] = discretize(rpm, p->rpm, 3);
+	}
+
+	raw[0] = BRAKE_INDEX(*speed, *brake_rate);
+	raw[1] = CLUTCH_INDEX(*rpm_rate, has_brake);
+}
+
+
+// classe da amostra dadas as variacoes de rpm e freio desde a anterior; atualiza last_*
+static unsigned char classifyDelta(wear_ctx_t *ctx, uint32_t dt_us, short rpm, short spd, short brk, short d_rpm, short d_brk) {
+	const wear_profile_t *p = WEAR_PROFILE(ctx);
+	char speed, brake_rate, rpm_rate;
+	unsigned char raw[3];
 
-	//printf("rpm_rate:%d\n", (rpm - last_rpm));
-	has_brake = (brk > 500)? 1: 0;
+	//printf("rpm: %d\nspd: %d\nbrk: %d\n", rpm, spd, brk);
 
-	char brake_vars[] = {speed, brake_rate};
-	char clutch_vars[] = {rpm_rate, has_brake};
+	rawIndex(p, rpm, spd, brk, d_rpm, d_brk, &speed, &brake_rate, &rpm_rate, raw);
 
-	char brake_idx = verifyWear(brake_vars, brake_vars_bits, 2, BRAKE_WEAR);
-	char clutch_idx = verifyWear(clutch_vars, clutch_vars_bits, 2, CLUTCH_WEAR);
-	char rpm_idx = discretize(rpm, RPM_THRESHOLD, 3);
+	char brake_idx = p->brake_wear[raw[0]];
+	char clutch_idx = p->clutch_wear[raw[1]];
+	char rpm_idx = raw[2];
 
 	// printf("brake_idx: %u\nclutch_idx: %u\nrpm_idx: %u\n", brake_idx, clutch_idx, rpm_idx);
-	
-	CUMULATIVE_BRAKE[brake_idx] += 1;
-	CUMULATIVE_CLUTCH[clutch_idx] += 1;
-	CUMULATIVE_RPM[rpm_idx] += 1;
 
-	// printf("BRAKE: "); printhex(CUMULATIVE_BRAKE, 4);
-	// printf("CLUTCH: "); printhex(CUMULATIVE_CLUTCH, 4);
-	// printf("RPM: "); printhex(CUMULATIVE_RPM, 4);
+	if (ctx->quant != NULL)
+		addWearQuant(ctx->quant, rpm, spd, brk, d_rpm, d_brk);
+
+	unsigned char cls = WEAR_CLASS(brake_idx, clutch_idx, rpm_idx);
+
+	if (ctx->on_event != NULL)
+		checkEvents(ctx, dt_us, spd, brake_rate, rpm_rate, d_rpm, d_brk, cls);
+
+	ctx->last_brk = brk;
+	ctx->last_rpm = rpm;
+
+	return cls;
+}
+
+
+void classifyWearRaw(wear_ctx_t *ctx, short rpm, short spd, short brk, unsigned char raw[3]) {
+	char speed, brake_rate, rpm_rate;
+
+	rawIndex(WEAR_PROFILE(ctx), rpm, spd, brk, (short) (rpm - ctx->last_rpm), (short) (brk - ctx->last_brk),
+		&speed, &brake_rate, &rpm_rate, raw);
+	ctx->last_brk = brk;
+	ctx->last_rpm = rpm;
+}
+
+
+unsigned char classifyWear(wear_ctx_t *ctx, short rpm, short spd, short brk) {	//classe da amostra, atualiza last_*
+	return classifyDelta(ctx, 0, rpm, spd, brk, (short) (rpm - ctx->last_rpm), (short) (brk - ctx->last_brk));
+}
+
+
+unsigned char classifyWearT(wear_ctx_t *ctx, uint32_t t_us, short rpm, short spd, short brk) {
+	short d_rpm = (short) (rpm - ctx->last_rpm), d_brk = (short) (brk - ctx->last_brk);
+	uint32_t dt_us = t_us - ctx->last_t_us;	//sem sinal, sobrevive ao estouro de micros()
+
+	if (ctx->has_t && dt_us != 0 && dt_us != WEAR_RATE_PERIOD_US) {
+		d_rpm = scaleDelta(d_rpm, dt_us);
+		d_brk = scaleDelta(d_brk, dt_us);
+	} else {
+		dt_us = 0;	//periodo nominal, nada a corrigir
+	}
+
+	ctx->last_t_us = t_us;
+	ctx->has_t = 1;
+	return classifyDelta(ctx, dt_us, rpm, spd, brk, d_rpm, d_brk);
+}
+
+
+void addWearClass(wear_hist_t *hist, unsigned char cls) {
+	WEAR_INC(hist->brake[WEAR_CLASS_BRAKE(cls)]);
+	WEAR_INC(hist->clutch[WEAR_CLASS_CLUTCH(cls)]);
+	WEAR_INC(hist->rpm[WEAR_CLASS_RPM(cls)]);
+
+	// printf("BRAKE: "); printhex(hist->brake, 4);
+	// printf("CLUTCH: "); printhex(hist->clutch, 4);
+	// printf("RPM: "); printhex(hist->rpm, 4);
+}
+
 
-	last_brk = brk;
-	last_rpm = rpm;
+void accumulateWearCtx(wear_ctx_t *ctx, short rpm, short spd, short brk) {	//acumula valores de desgaste
+	addWearClass(&ctx->hist, classifyWear(ctx, rpm, spd, brk));
 
 	return;
 }
 
 
-void resetWear(char v_len) {
-	short *v[] = {CUMULATIVE_RPM, CUMULATIVE_CLUTCH, CUMULATIVE_BRAKE};
+void accumulateWearT(wear_ctx_t *ctx, uint32_t t_us, short rpm, short spd, short brk) {
+	addWearClass(&ctx->hist, classifyWearT(ctx, t_us, rpm, spd, brk));
+
+	return;
+}
+
+
+void resetWearCtx(wear_ctx_t *ctx, char v_len) {
+	wear_acc_t *v[] = {ctx->hist.rpm, ctx->hist.clutch, ctx->hist.brake};
 	for(char i = 0; i < 3; i++)
 	{
 		for(char j = 0; j < v_len; j++)
@@ -125,51 +362,185 @@ void resetWear(char v_len) {
 }
 
 
-char average(short vect[], short weight[]) {
-	char i;
-	short total = 0, value = 0, step;
+static wear_wide_t wideAdd(wear_wide_t a, wear_wide_t b) {	//soma saturada
+	return (b > WEAR_WIDE_MAX - a)? WEAR_WIDE_MAX: a + b;
+}
+
+
+static wear_wide_t wideShl(wear_wide_t a, char bits) {
+	return (a > (WEAR_WIDE_MAX >> bits))? WEAR_WIDE_MAX: a << bits;
+}
+
+
+static char discretizeSteps(wear_wide_t value, wear_wide_t step) {	//discretize com limiares {step, 2*step, 3*step}
+	wear_wide_t step2 = wideAdd(step, step);
+	wear_wide_t step3 = wideAdd(step2, step);
+
+	return (value > step) + (value > step2) + (value > step3);
+}
 
+
+static void weightedSums(const wear_acc_t vect[], const char weight[], wear_wide_t *value, wear_wide_t *total) {	//soma de classe*contagem e de contagem, com peso
+	char i, j;
+	wear_wide_t count;
+
+	*value = 0;
+	*total = 0;
 	for (i = 0; i < 4; i++) {
-		vect[i] <<= weight[i];
-		value += vect[i] * i;
-		total += vect[i];
+		count = wideShl(vect[i], weight[i]);
+		for (j = 0; j < i; j++)
+			*value = wideAdd(*value, count);
+		*total = wideAdd(*total, count);
 	}
+}
+
+
+char average(const wear_acc_t vect[], const char weight[]) {
+	wear_wide_t total, value;
 
-	step = 3*total / 4;
-	short v[] = {step, (short)(2*step), (short)(3*step)};
-	return discretize(value, v, 3);
+	weightedSums(vect, weight, &value, &total);
+	return discretizeSteps(value, wideAdd(total, wideAdd(total, total)) / 4);
 }
 
 
-char percent(short vect[], char idx, char len) {
+char percent(const wear_acc_t vect[], char idx, char len) {
 	char i;
-	short total = 0, step;
+	wear_wide_t total = 0;
 
 	for (i = 0; i < 4; i++) {
-		total += vect[i];
+		total = wideAdd(total, vect[i]);
 	}
 
-	step = total / 4;
-	short v[] = {step, (short)(2*step), (short)(3*step)};
-	return discretize(vect[idx], v, 3);
+	return discretizeSteps(vect[idx], total / 4);
 }
 
 
-void wearData(unsigned char* data_ret) {
+static uint16_t ratioQ10(wear_wide_t num, wear_wide_t den) {	//num/den em Q0.10, num <= den; desloca e subtrai, sem divisao
+	uint16_t q = 0;
+
+	if (den == 0)
+		return 0;
+	if (num >= den)
+		return 1 << 10;
+	for (char i = 0; i < 10; i++) {
+		q <<= 1;
+		if (num >= den - num) {	//2*num >= den sem estourar
+			num -= den - num;
+			q |= 1;
+		} else {
+			num += num;
+		}
+	}
+	return q;
+}
+
+
+// razao r em [0, 1] (Q0.10) no eixo das classes: 4r - 0.5 em Q8.8, de 0 a 3.
+// discretizeSteps corta r em 1/4, 2/4 e 3/4, entao a classe e o valor arredondado
+static uint16_t classAxis(uint16_t r) {
+	if (r < WEAR_SCORE_ONE/2)
+		return 0;
+	r -= WEAR_SCORE_ONE/2;
+	return (r > WEAR_SCORE_MAX)? WEAR_SCORE_MAX: r;
+}
+
+
+static uint16_t averageScore(const wear_acc_t vect[], const char weight[]) {	//average sem discretizar
+	wear_wide_t total, value;
+
+	weightedSums(vect, weight, &value, &total);
+	return classAxis(ratioQ10(value, wideAdd(total, wideAdd(total, total))));
+}
+
+
+static uint16_t percentScore(const wear_acc_t vect[], char idx) {	//percent sem discretizar
+	wear_wide_t total = 0;
+
+	for (char i = 0; i < 4; i++)
+		total = wideAdd(total, vect[i]);
+	return classAxis(ratioQ10(vect[(int) idx], total));
+}
+
+
+static uint16_t interpEngine(const char table[], uint16_t rpm, uint16_t rpm_time) {	//bilinear em table[ENGINE_INDEX], eixos em Q8.8
+	char x = (rpm >= WEAR_SCORE_MAX)? 2: rpm >> 8;
+	char y = (rpm_time >= WEAR_SCORE_MAX)? 2: rpm_time >> 8;
+	uint32_t fx = rpm - (x << 8), fy = rpm_time - (y << 8);
+	uint32_t lo = (WEAR_SCORE_ONE - fy)*table[ENGINE_INDEX(x, y)] + fy*table[ENGINE_INDEX(x, y + 1)];
+	uint32_t hi = (WEAR_SCORE_ONE - fy)*table[ENGINE_INDEX(x + 1, y)] + fy*table[ENGINE_INDEX(x + 1, y + 1)];
+
+	return (uint16_t) (((WEAR_SCORE_ONE - fx)*lo + fx*hi) >> 8);
+}
+
+
+void mergeWearHist(wear_hist_t *dst, const wear_hist_t *src) {
+	for (char i = 0; i < 4; i++) {
+		dst->brake[i] = wearAccAdd(dst->brake[i], src->brake[i]);
+		dst->clutch[i] = wearAccAdd(dst->clutch[i], src->clutch[i]);
+		dst->rpm[i] = wearAccAdd(dst->rpm[i], src->rpm[i]);
+	}
+}
+
+
+void wearDataProfile(const wear_hist_t *hist, const wear_profile_t *p, unsigned char* data_ret) {
 	char brake_wear, clutch_wear, engine_wear, rpm, rpm_time;
-	char engine_vars_bits[] = {2, 2};
-	short rpm_weight[] = {0, 0, 0, 0}, brake_weight[] = {0, 1, 5, 8}, clutch_weight[] = {0, 1, 5, 8};
 
-	rpm = average(CUMULATIVE_RPM, rpm_weight);
-	rpm_time = percent(CUMULATIVE_RPM, rpm, 4);
+	rpm = average(hist->rpm, p->rpm_weight);
+	rpm_time = percent(hist->rpm, rpm, 4);
 	
-	char engine_vars[] = {rpm, rpm_time};
-
-	brake_wear = average(CUMULATIVE_BRAKE, brake_weight);
-	clutch_wear = average(CUMULATIVE_CLUTCH, clutch_weight);
-	engine_wear = verifyWear(engine_vars, engine_vars_bits, 2, ENGINE_WEAR);
+	brake_wear = average(hist->brake, p->brake_weight);
+	clutch_wear = average(hist->clutch, p->clutch_weight);
+	engine_wear = p->engine_wear[ENGINE_INDEX(rpm, rpm_time)];
 
 	data_ret[0] = (brake_wear << 4) + (clutch_wear << 2) + engine_wear;
 	data_ret[1] = '\0';
 }
 
+
+void wearDataHist(const wear_hist_t *hist, unsigned char* data_ret) {
+	wearDataProfile(hist, &WEAR_DEFAULT_PROFILE, data_ret);
+}
+
+
+void wearDataCtx(wear_ctx_t *ctx, unsigned char* data_ret) {
+	wearDataProfile(&ctx->hist, WEAR_PROFILE(ctx), data_ret);
+}
+
+
+void wearScoreProfile(const wear_hist_t *hist, const wear_profile_t *p, wear_score_t *score) {
+	char rpm = average(hist->rpm, p->rpm_weight);	//mesma coluna de tempo que wearDataProfile
+
+	score->brake = averageScore(hist->brake, p->brake_weight);
+	score->clutch = averageScore(hist->clutch, p->clutch_weight);
+	score->engine = interpEngine(p->engine_wear, averageScore(hist->rpm, p->rpm_weight), percentScore(hist->rpm, rpm));
+}
+
+
+void wearScoreHist(const wear_hist_t *hist, wear_score_t *score) {
+	wearScoreProfile(hist, &WEAR_DEFAULT_PROFILE, score);
+}
+
+
+void wearScoreCtx(wear_ctx_t *ctx, wear_score_t *score) {
+	wearScoreProfile(&ctx->hist, WEAR_PROFILE(ctx), score);
+}
+
+
+void accumulateWear(short rpm, short spd, short brk) {
+	accumulateWearCtx(&DEFAULT_WEAR, rpm, spd, brk);
+}
+
+
+void resetWear(char v_len) {
+	resetWearCtx(&DEFAULT_WEAR, v_len);
+}
+
+
+void wearData(unsigned char* data_ret) {
+	wearDataCtx(&DEFAULT_WEAR, data_ret);
+}
+
+
+void wearScore(wear_score_t *score) {
+	wearScoreCtx(&DEFAULT_WEAR, score);
+}
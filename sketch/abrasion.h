@@ -1,12 +1,225 @@
 #ifndef ABRASION_H
 #define ABRASION_H
 
-char discretize(short value, short thresh[], char len);
-char verifyWear(char param[], char param_bits[], char n_param, char wear[]);
+#include <stddef.h>
+#include <stdint.h>
+
+#define BRK_ON_THRESHOLD 500	//acima disso o pedal de freio esta pressionado
+
+// periodo de amostragem para o qual os limiares de taxa foram calibrados
+#ifndef WEAR_RATE_PERIOD_US
+#define WEAR_RATE_PERIOD_US 100000UL
+#endif
+
+// limiares das classes, em ordem crescente
+#define RPM_T0 1500
+#define RPM_T1 2500
+#define RPM_T2 3500
+#define SPD_T0 6
+#define SPD_T1 13
+#define SPD_T2 20
+#define BRK_T0 1000
+#define BRK_T1 2000
+#define BRK_T2 3000
+#define RPM_RATE_T0 15
+#define RPM_RATE_T1 30
+#define RPM_RATE_T2 45
+#define BRK_RATE_T0 16
+#define BRK_RATE_T1 32
+#define BRK_RATE_T2 64
+
+// 1: classifica por tabelas (wear_lut.h); 0: busca linear, para alvos com pouca flash
+#ifndef WEAR_USE_LUT
+#if defined(__AVR__)
+#define WEAR_USE_LUT 0
+#else
+#define WEAR_USE_LUT 1
+#endif
+#endif
+
+extern const short BRK_THRESHOLD[];	//freio acionado; nenhum perfil usa
+
+// falha a compilacao se cond for falsa (C89, C99 e C++)
+#define WEAR_STATIC_ASSERT(name, cond) typedef char name##_static_assert[(cond) ? 1 : -1]
+
+// largura em bits de cada campo do indice das tabelas *_WEAR
+#define BRAKE_SPD_BITS		2
+#define BRAKE_RATE_BITS		2
+#define CLUTCH_RATE_BITS	2
+#define CLUTCH_BRK_BITS		1
+#define ENGINE_RPM_BITS		2
+#define ENGINE_TIME_BITS	2
+
+#define WEAR_TABLE_LEN(hi_bits, lo_bits) (1 << ((hi_bits) + (lo_bits)))
+#define WEAR_INDEX(hi, lo, lo_bits) (((hi) << (lo_bits)) | (lo))
+
+#define BRAKE_WEAR_LEN		WEAR_TABLE_LEN(BRAKE_SPD_BITS, BRAKE_RATE_BITS)
+#define CLUTCH_WEAR_LEN		WEAR_TABLE_LEN(CLUTCH_RATE_BITS, CLUTCH_BRK_BITS)
+#define ENGINE_WEAR_LEN		WEAR_TABLE_LEN(ENGINE_RPM_BITS, ENGINE_TIME_BITS)
+
+#define BRAKE_INDEX(speed, brake_rate)		WEAR_INDEX(speed, brake_rate, BRAKE_RATE_BITS)
+#define CLUTCH_INDEX(rpm_rate, has_brake)	WEAR_INDEX(rpm_rate, has_brake, CLUTCH_BRK_BITS)
+#define ENGINE_INDEX(rpm, rpm_time)			WEAR_INDEX(rpm, rpm_time, ENGINE_TIME_BITS)
+
+
+typedef struct {	//limiares, pesos e tabelas usados por um contexto
+	short rpm[3], spd[3], rpm_rate[3], brk_rate[3];	//crescentes
+	char rpm_weight[4], brake_weight[4], clutch_weight[4];
+	char brake_wear[BRAKE_WEAR_LEN], clutch_wear[CLUTCH_WEAR_LEN], engine_wear[ENGINE_WEAR_LEN];	//classes 0..3
+} wear_profile_t;
+
+// o das macros acima; so ele usa as tabelas de wear_lut.h
+extern const wear_profile_t WEAR_DEFAULT_PROFILE;
+
+// nomes antigos, so leitura: os mesmos dados do perfil padrao, que e o que o
+// motor usa; um contexto com outro perfil nao passa por eles
+#define RPM_THRESHOLD		(WEAR_DEFAULT_PROFILE.rpm)
+#define SPD_THRESHOLD		(WEAR_DEFAULT_PROFILE.spd)
+#define RPM_RATE_THRESHOLD	(WEAR_DEFAULT_PROFILE.rpm_rate)
+#define BRK_RATE_THRESHOLD	(WEAR_DEFAULT_PROFILE.brk_rate)
+#define BRAKE_WEAR			(WEAR_DEFAULT_PROFILE.brake_wear)
+#define CLUTCH_WEAR			(WEAR_DEFAULT_PROFILE.clutch_wear)
+#define ENGINE_WEAR			(WEAR_DEFAULT_PROFILE.engine_wear)
+
+// largura dos contadores dos histogramas: 16, 32 ou 64 bits
+#ifndef WEAR_ACC_BITS
+#if defined(__AVR__)
+#define WEAR_ACC_BITS 16
+#else
+#define WEAR_ACC_BITS 32
+#endif
+#endif
+
+#if WEAR_ACC_BITS == 16
+typedef uint16_t wear_acc_t;
+typedef uint32_t wear_wide_t;	//cabe contagem << peso * classe sem estourar
+#define WEAR_ACC_MAX UINT16_MAX
+#elif WEAR_ACC_BITS == 32
+typedef uint32_t wear_acc_t;
+typedef uint64_t wear_wide_t;
+#define WEAR_ACC_MAX UINT32_MAX
+#elif WEAR_ACC_BITS == 64
+typedef uint64_t wear_acc_t;
+typedef uint64_t wear_wide_t;	//aqui as somas de average/percent saturam
+#define WEAR_ACC_MAX UINT64_MAX
+#else
+#error "WEAR_ACC_BITS deve ser 16, 32 ou 64"
+#endif
+
+#define WEAR_WIDE_MAX ((wear_wide_t) -1)
+
+#define WEAR_INC(acc) ((acc) += ((acc) != WEAR_ACC_MAX))	//incremento saturado
+
+static inline wear_acc_t wearAccAdd(wear_acc_t acc, uint64_t n) {	//soma saturada
+	return (n > (uint64_t) (WEAR_ACC_MAX - acc))? WEAR_ACC_MAX: (wear_acc_t) (acc + n);
+}
+
+typedef struct {	//histogramas de desgaste, um contador por classe
+	wear_acc_t brake[4];
+	wear_acc_t clutch[4];
+	wear_acc_t rpm[4];
+} wear_hist_t;
+
+// classe de uma amostra, no mesmo formato do byte de desgaste
+#define WEAR_CLASS(brake, clutch, rpm)	(((brake) << 4) | ((clutch) << 2) | (rpm))
+#define WEAR_CLASS_BRAKE(c)		(((c) >> 4) & 0x3)
+#define WEAR_CLASS_CLUTCH(c)	(((c) >> 2) & 0x3)
+#define WEAR_CLASS_RPM(c)		((c) & 0x3)
+
+struct wear_quant;	//wear_quantile.h
+
+#define WEAR_TOP_CLASS 3
+
+enum {	//eventos bruscos, relatados na hora sem esperar a janela
+	WEAR_EVENT_BRAKE = 1,	//taxa de freio na classe mais alta
+	WEAR_EVENT_RPM,			//taxa de rpm na classe mais alta
+	WEAR_EVENT_JERK			//variacao da aceleracao acima de jerk_limit
+};
+
+typedef struct {
+	char type;
+	short value;		//variacao que disparou o evento
+	unsigned char cls;	//classe da amostra, formato WEAR_CLASS
+} wear_event_t;
+
+typedef void (*wear_event_cb_t)(void *user, const wear_event_t *ev);
+
+typedef struct {	//estado de um veiculo
+	wear_hist_t hist;
+	short last_brk, last_rpm;
+	uint32_t last_t_us;			//usado por accumulateWearT
+	char has_t;
+	struct wear_quant *quant;	//opcional, NULL desliga os sketches de quantis
+	wear_event_cb_t on_event;	//opcional, chamado na borda de subida de cada evento
+	void *event_user;
+	short jerk_limit;			//por WEAR_RATE_PERIOD_US ao quadrado (accumulateWearT normaliza); 0 desliga
+	short last_spd, last_acc;
+	char spd_seen;				//amostras de velocidade ja vistas, ate 2
+	char event_state;			//um bit por evento ativo
+	const wear_profile_t *profile;	//NULL usa WEAR_DEFAULT_PROFILE
+	const wear_profile_t *next_profile;	//pedido por requestWearProfile, aplicado por swapWearProfile
+} wear_ctx_t;
+
+// contexto zerado (sem initWear) tambem vale
+#define WEAR_PROFILE(ctx)	((ctx)->profile != NULL? (ctx)->profile: &WEAR_DEFAULT_PROFILE)
+
+#define WEAR_SCORE_ONE	256		//Q8.8
+#define WEAR_SCORE_MAX	(3*WEAR_SCORE_ONE)
+
+typedef struct {	//desgaste continuo, Q8.8 de 0 a WEAR_SCORE_MAX; brake e clutch arredondados dao a classe
+	uint16_t brake, clutch, engine;	//engine interpola ENGINE_WEAR
+} wear_score_t;
+
+typedef struct {	//contagens por indice combinado, antes das tabelas *_wear
+	uint64_t brake[BRAKE_WEAR_LEN];
+	uint64_t clutch[CLUTCH_WEAR_LEN];
+	uint64_t rpm[4];
+} wear_raw_t;
+
+char discretize(short value, const short thresh[], char len);
+char verifyWear(char param[], char param_bits[], char n_param, const char wear[]);
+char average(const wear_acc_t vect[], const char weight[]);
+char percent(const wear_acc_t vect[], char idx, char len);
+char rate(short x1, short x2, const short vect[]);
+
+void initWear(wear_ctx_t *ctx);
+// 1 se os limiares sao crescentes e as tabelas so tem classes 0..3
+char checkWearProfile(const wear_profile_t *p);
+void setWearProfile(wear_ctx_t *ctx, const wear_profile_t *p);
+// troca sem trava: request pode vir de outra thread ou de interrupcao, swap e
+// chamado por quem fecha a janela; p fica em uso ate o proximo swap
+void requestWearProfile(wear_ctx_t *ctx, const wear_profile_t *p);
+char swapWearProfile(wear_ctx_t *ctx);	//1 se trocou
+unsigned char classifyWear(wear_ctx_t *ctx, short rpm, short spd, short brk);
+unsigned char classifyWearT(wear_ctx_t *ctx, uint32_t t_us, short rpm, short spd, short brk);
+// indices combinados (brake, clutch, rpm) da amostra, atualiza last_*; sem quantis nem eventos
+void classifyWearRaw(wear_ctx_t *ctx, short rpm, short spd, short brk, unsigned char raw[3]);
+void addWearClass(wear_hist_t *hist, unsigned char cls);
+void accumulateWearCtx(wear_ctx_t *ctx, short rpm, short spd, short brk);
+// t_us em microssegundos; as taxas sao normalizadas para WEAR_RATE_PERIOD_US
+void accumulateWearT(wear_ctx_t *ctx, uint32_t t_us, short rpm, short spd, short brk);
+void resetWearCtx(wear_ctx_t *ctx, char v_len);
+void setWearEvents(wear_ctx_t *ctx, wear_event_cb_t cb, void *user, short jerk_limit);
+void wearDataCtx(wear_ctx_t *ctx, unsigned char* data_ret);
+void wearDataHist(const wear_hist_t *hist, unsigned char* data_ret);
+void wearDataProfile(const wear_hist_t *hist, const wear_profile_t *p, unsigned char* data_ret);
+// so inteiros, sem divisao (Cortex-M0+); nao muda o byte de wearData*
+void wearScoreCtx(wear_ctx_t *ctx, wear_score_t *score);
+void wearScoreHist(const wear_hist_t *hist, wear_score_t *score);
+void wearScoreProfile(const wear_hist_t *hist, const wear_profile_t *p, wear_score_t *score);
+void mergeWearHist(wear_hist_t *dst, const wear_hist_t *src);
+
+// entrada em vetores separados por variavel; mesmo resultado de n chamadas a accumulateWearCtx
+void accumulateWearBatch(wear_ctx_t *ctx, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n);
+// soma em raw os indices combinados, sem passar pelas tabelas; foldWearRaw
+// aplica as tabelas de qualquer perfil com os mesmos limiares
+void accumulateWearRaw(wear_ctx_t *ctx, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n, wear_raw_t *raw);
+void foldWearRaw(const wear_raw_t *raw, const wear_profile_t *p, wear_hist_t *hist);
+
+// API de um unico veiculo, sobre um contexto padrao
 void accumulateWear(short rpm, short spd, short brk);
-char percent(short vect[], char idx, char len);
-char rate(short x1, short x2, short vect[]);
 void resetWear(char v_len);
 void wearData(unsigned char* data_ret);
+void wearScore(wear_score_t *score);
 
 #endif // ABRASION_H
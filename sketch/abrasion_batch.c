@@ -0,0 +1,263 @@
+#include "abrasion.h"
+#include "wear_quantile.h"
+
+/*
+ * Versao em lote de accumulateWearCtx. Os limiares sao crescentes, entao
+ * discretize(v) == (v > t0) + (v > t1) + (v > t2), que vira tres comparacoes
+ * vetoriais. Cada amostra gera um indice combinado (o mesmo que verifyWear
+ * monta); os indices sao empacotados em bytes e contados por lane com cmpeq.
+ * Um passo em que todos os indices sao 0 (marcha lenta: parado, rpm baixo,
+ * sem freio e sem variacao) pula a contagem e entra em bloco no fim.
+ * No fim do lote as contagens (wear_raw_t) passam pelas tabelas do perfil
+ * e entram no histograma; accumulateWearRaw devolve as contagens sem dobrar,
+ * para varios perfis com os mesmos limiares reaproveitarem a passada.
+ */
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i vec_t;
+#define V_LANES		16
+#define V_LOAD(p)	_mm256_loadu_si256((const __m256i *)(p))
+#define V_STORE(p, v)	_mm256_storeu_si256((__m256i *)(p), v)
+#define V_SET1		_mm256_set1_epi16
+#define V_SET1_8	_mm256_set1_epi8
+#define V_ZERO		_mm256_setzero_si256
+#define V_GT		_mm256_cmpgt_epi16
+#define V_SUB		_mm256_sub_epi16
+#define V_AND		_mm256_and_si256
+#define V_OR		_mm256_or_si256
+#define V_SLLI		_mm256_slli_epi16
+#define V_PACKS		_mm256_packs_epi16
+#define V_EQ8		_mm256_cmpeq_epi8
+#define V_SUB8		_mm256_sub_epi8
+#define V_SAD(v)	_mm256_sad_epu8(v, _mm256_setzero_si256())
+#define V_ADD64		_mm256_add_epi64
+#define V_IS_ZERO(v)	_mm256_testz_si256(v, v)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i vec_t;
+#define V_LANES		8
+#define V_LOAD(p)	_mm_loadu_si128((const __m128i *)(p))
+#define V_STORE(p, v)	_mm_storeu_si128((__m128i *)(p), v)
+#define V_SET1		_mm_set1_epi16
+#define V_SET1_8	_mm_set1_epi8
+#define V_ZERO		_mm_setzero_si128
+#define V_GT		_mm_cmpgt_epi16
+#define V_SUB		_mm_sub_epi16
+#define V_AND		_mm_and_si128
+#define V_OR		_mm_or_si128
+#define V_SLLI		_mm_slli_epi16
+#define V_PACKS		_mm_packs_epi16
+#define V_EQ8		_mm_cmpeq_epi8
+#define V_SUB8		_mm_sub_epi8
+#define V_SAD(v)	_mm_sad_epu8(v, _mm_setzero_si128())
+#define V_ADD64		_mm_add_epi64
+#define V_IS_ZERO(v)	(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF)
+#endif
+
+
+#ifdef V_LANES
+
+#define STEP		(2*V_LANES)	//amostras por iteracao, um vetor de bytes
+#define BLOCK_ITERS	255			//contadores de 8 bits por lane
+
+typedef struct {
+	vec_t t0, t1, t2;
+} vthresh_t;
+
+typedef struct {
+	vthresh_t spd, rpm, brk_rate, rpm_rate;
+	vec_t brk_on, one;
+} vparams_t;
+
+typedef struct {	//indices combinados de 2*V_LANES amostras, um por byte
+	vec_t brake, clutch, rpm;
+} vcodes_t;
+
+
+static vthresh_t vthresh(const short thresh[]) {
+	vthresh_t t;
+
+	t.t0 = V_SET1(thresh[0]);
+	t.t1 = V_SET1(thresh[1]);
+	t.t2 = V_SET1(thresh[2]);
+	return t;
+}
+
+
+static inline vec_t vdiscretize(vec_t v, const vthresh_t *t) {	//mascaras sao -1, por isso a subtracao
+	vec_t out = V_SUB(V_ZERO(), V_GT(v, t->t0));
+	out = V_SUB(out, V_GT(v, t->t1));
+	return V_SUB(out, V_GT(v, t->t2));
+}
+
+
+static inline void vclassify(const vparams_t *p, const int16_t* rpm, const int16_t* spd, const int16_t* brk,
+		vec_t *brake_in, vec_t *clutch_in, vec_t *rpm_idx) {
+	vec_t v_rpm = V_LOAD(rpm), v_brk = V_LOAD(brk);
+	vec_t speed = vdiscretize(V_LOAD(spd), &p->spd);
+	vec_t brake_rate = vdiscretize(V_SUB(v_brk, V_LOAD(brk - 1)), &p->brk_rate);
+	vec_t rpm_rate = vdiscretize(V_SUB(v_rpm, V_LOAD(rpm - 1)), &p->rpm_rate);
+	vec_t has_brake = V_AND(V_GT(v_brk, p->brk_on), p->one);
+
+	*brake_in = V_OR(V_SLLI(speed, BRAKE_RATE_BITS), brake_rate);
+	*clutch_in = V_OR(V_SLLI(rpm_rate, CLUTCH_BRK_BITS), has_brake);
+	*rpm_idx = vdiscretize(v_rpm, &p->rpm);
+}
+
+
+static inline vcodes_t vcodes(const vparams_t *p, const int16_t* rpm, const int16_t* spd, const int16_t* brk) {
+	vec_t b0, c0, r0, b1, c1, r1;
+	vcodes_t out;
+
+	vclassify(p, rpm, spd, brk, &b0, &c0, &r0);
+	vclassify(p, rpm + V_LANES, spd + V_LANES, brk + V_LANES, &b1, &c1, &r1);
+
+	// packs embaralha as metades no AVX2, o que nao importa para contagem
+	out.brake = V_PACKS(b0, b1);
+	out.clutch = V_PACKS(c0, c1);
+	out.rpm = V_PACKS(r0, r1);
+	return out;
+}
+
+
+static unsigned long long hsum64(vec_t v) {
+	unsigned long long lanes[V_LANES/4], sum = 0;
+
+	V_STORE(lanes, v);
+	for (int i = 0; i < V_LANES/4; i++)
+		sum += lanes[i];
+	return sum;
+}
+
+
+// conta os indices das amostras [1, n) em raw, usando x[i-1] como leitura anterior
+static size_t batchKernel(wear_ctx_t *ctx, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n, wear_raw_t *raw) {
+	const wear_profile_t *prof = WEAR_PROFILE(ctx);
+	vparams_t p;
+	vec_t n_brake[BRAKE_WEAR_LEN], n_clutch[CLUTCH_WEAR_LEN], n_rpm[4];
+	size_t i = 1, idle = 0;	//passos de marcha lenta
+	int k;
+
+	p.spd = vthresh(prof->spd);
+	p.rpm = vthresh(prof->rpm);
+	p.brk_rate = vthresh(prof->brk_rate);
+	p.rpm_rate = vthresh(prof->rpm_rate);
+	p.brk_on = V_SET1(BRK_ON_THRESHOLD);
+	p.one = V_SET1(1);
+
+	for (k = 0; k < BRAKE_WEAR_LEN; k++) n_brake[k] = V_ZERO();
+	for (k = 0; k < CLUTCH_WEAR_LEN; k++) n_clutch[k] = V_ZERO();
+	for (k = 0; k < 4; k++) n_rpm[k] = V_ZERO();
+
+	while (i + STEP <= n) {
+		vec_t c_brake[BRAKE_WEAR_LEN], c_clutch[CLUTCH_WEAR_LEN], c_rpm[4];
+		int iters;
+
+		for (k = 0; k < BRAKE_WEAR_LEN; k++) c_brake[k] = V_ZERO();
+		for (k = 0; k < CLUTCH_WEAR_LEN; k++) c_clutch[k] = V_ZERO();
+		for (k = 0; k < 4; k++) c_rpm[k] = V_ZERO();
+
+		for (iters = 0; i + STEP <= n && iters < BLOCK_ITERS; i += STEP, iters++) {
+			vcodes_t c = vcodes(&p, rpm + i, spd + i, brk + i);
+
+			if (V_IS_ZERO(V_OR(V_OR(c.brake, c.clutch), c.rpm))) {
+				idle++;
+				continue;
+			}
+			for (k = 0; k < BRAKE_WEAR_LEN; k++)
+				c_brake[k] = V_SUB8(c_brake[k], V_EQ8(c.brake, V_SET1_8(k)));
+			for (k = 0; k < CLUTCH_WEAR_LEN; k++)
+				c_clutch[k] = V_SUB8(c_clutch[k], V_EQ8(c.clutch, V_SET1_8(k)));
+			for (k = 0; k < 4; k++)
+				c_rpm[k] = V_SUB8(c_rpm[k], V_EQ8(c.rpm, V_SET1_8(k)));
+		}
+
+		for (k = 0; k < BRAKE_WEAR_LEN; k++) n_brake[k] = V_ADD64(n_brake[k], V_SAD(c_brake[k]));
+		for (k = 0; k < CLUTCH_WEAR_LEN; k++) n_clutch[k] = V_ADD64(n_clutch[k], V_SAD(c_clutch[k]));
+		for (k = 0; k < 4; k++) n_rpm[k] = V_ADD64(n_rpm[k], V_SAD(c_rpm[k]));
+	}
+
+	for (k = 0; k < BRAKE_WEAR_LEN; k++) raw->brake[k] += hsum64(n_brake[k]);
+	for (k = 0; k < CLUTCH_WEAR_LEN; k++) raw->clutch[k] += hsum64(n_clutch[k]);
+	for (k = 0; k < 4; k++) raw->rpm[k] += hsum64(n_rpm[k]);
+	raw->brake[BRAKE_INDEX(0, 0)] += idle*STEP;
+	raw->clutch[CLUTCH_INDEX(0, 0)] += idle*STEP;
+	raw->rpm[0] += idle*STEP;
+
+	ctx->last_brk = brk[i-1];
+	ctx->last_rpm = rpm[i-1];
+	return i;
+}
+
+#endif // V_LANES
+
+
+void foldWearRaw(const wear_raw_t *raw, const wear_profile_t *p, wear_hist_t *hist) {
+	int k;
+
+	for (k = 0; k < BRAKE_WEAR_LEN; k++) {
+		wear_acc_t *acc = &hist->brake[(int) p->brake_wear[k]];
+		*acc = wearAccAdd(*acc, raw->brake[k]);
+	}
+	for (k = 0; k < CLUTCH_WEAR_LEN; k++) {
+		wear_acc_t *acc = &hist->clutch[(int) p->clutch_wear[k]];
+		*acc = wearAccAdd(*acc, raw->clutch[k]);
+	}
+	for (k = 0; k < 4; k++)
+		hist->rpm[k] = wearAccAdd(hist->rpm[k], raw->rpm[k]);
+}
+
+
+void accumulateWearRaw(wear_ctx_t *ctx, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n, wear_raw_t *raw) {
+	unsigned char idx[3];
+	size_t i = 0;
+
+	if (n == 0)
+		return;
+
+	classifyWearRaw(ctx, rpm[0], spd[0], brk[0], idx);	//a primeira amostra depende de ctx->last_*
+	raw->brake[idx[0]]++;
+	raw->clutch[idx[1]]++;
+	raw->rpm[idx[2]]++;
+	i = 1;
+
+#ifdef V_LANES
+	i = batchKernel(ctx, rpm, spd, brk, n, raw);
+#endif
+
+	for (; i < n; i++) {
+		classifyWearRaw(ctx, rpm[i], spd[i], brk[i], idx);
+		raw->brake[idx[0]]++;
+		raw->clutch[idx[1]]++;
+		raw->rpm[idx[2]]++;
+	}
+}
+
+
+void accumulateWearBatch(wear_ctx_t *ctx, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n) {
+	size_t i = 0;
+
+	if (n == 0)
+		return;
+
+#ifdef V_LANES
+	if (ctx->on_event == NULL) {	//eventos precisam de cada amostra em ordem, ficam no caminho escalar
+		wear_raw_t raw = {{0}, {0}, {0}};
+
+		accumulateWearCtx(ctx, rpm[0], spd[0], brk[0]);	//a primeira amostra depende de ctx->last_*
+		i = batchKernel(ctx, rpm, spd, brk, n, &raw);
+		foldWearRaw(&raw, WEAR_PROFILE(ctx), &ctx->hist);
+
+		if (ctx->quant != NULL) {	//o kernel so conta classes
+			for (size_t k = 1; k < i; k++)
+				addWearQuant(ctx->quant, rpm[k], spd[k], brk[k], (short) (rpm[k] - rpm[k-1]), (short) (brk[k] - brk[k-1]));
+		}
+	}
+#endif
+
+	for (; i < n; i++)
+		accumulateWearCtx(ctx, rpm[i], spd[i], brk[i]);
+
+	return;
+}
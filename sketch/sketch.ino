@@ -6,6 +6,7 @@
  extern "C"
  {
  	#include "abrasion.h"	
+ 	#include "wear_report.h"
  }
 
 union Pos {  // union consegue definir vários tipos de dados na mesma posição de memória
@@ -18,6 +19,15 @@ union Pos {  // union consegue definir vários tipos de dados na mesma posição
 #define PID_VEHICLE_SPEED	0x0D
 #define PID_COOLANT_TEMP	0x05
 
+#define REPORT_MIN_WINDOWS	1	//janelas minimas entre envios
+#define REPORT_MAX_WINDOWS	30	//heartbeat: envia mesmo sem mudanca
+#define REPORT_HYSTERESIS	2	//janelas seguidas para aceitar mudanca de uma classe
+#define JERK_LIMIT			8	//km/h por 100 ms ao quadrado (WEAR_RATE_PERIOD_US), acima disso e evento brusco
+#define EVENT_FLAG			0x80	//bit livre do byte de desgaste, marca pacote de evento
+#define SCORE_AT			9		//bytes 9..11: brake, clutch e engine em Q2.6 (wear_score_t >> 2)
+#define EVENT_TYPE_AT		SCORE_AT	//pacote de evento: o tipo vai no lugar do score de freio, os outros 2 zerados
+#define EVENT_MIN_MS		900000UL	//no maximo um pacote de evento a cada 15 min, pelo limite diario do Sigfox
+
 
 static void smartdelay(unsigned long ms);
 static void print_float(float val, float invalid, int len, int prec);
@@ -53,6 +63,23 @@ SoftwareSerial ssGps(TXPin, RXPin);
 //SIGFOX init
 SoftwareSerial ssSigfox(SigTXPin, SigRXPin);
 char msg[12];
+wear_ctx_t wear;
+wear_report_t report;
+volatile wear_event_t pending_event;	//type 0: nenhum evento pendente
+static const unsigned char EVENT_PRIORITY[] = {0, 3, 1, 2};	//por tipo: freio, jerk e por ultimo rpm, que dispara em qualquer acelerada
+WEAR_STATIC_ASSERT(event_priority, sizeof(EVENT_PRIORITY) == WEAR_EVENT_JERK + 1);
+unsigned long last_event_ms = 0;
+bool event_sent = false;	//o primeiro evento nao espera EVENT_MIN_MS
+
+
+static void onWearEvent(void *user, const wear_event_t *ev)	//fica o mais grave ate poder enviar
+{
+	if (EVENT_PRIORITY[(int) ev->type] <= EVENT_PRIORITY[(int) pending_event.type])
+		return;
+	pending_event.type = ev->type;
+	pending_event.value = ev->value;
+	pending_event.cls = ev->cls;
+}
 
 void setup() {
 	pinMode(13, OUTPUT);
@@ -70,12 +97,16 @@ void setup() {
 	}
 	Serial.println("CAN BUS Shield init ok!");
 	set_mask_filt();
+	initWear(&wear);
+	initWearReport(&report, REPORT_MIN_WINDOWS, REPORT_MAX_WINDOWS, REPORT_HYSTERESIS);
+	setWearEvents(&wear, onWearEvent, NULL, JERK_LIMIT);
 }
 
 
 void loop() {
 	unsigned char len = 0;
 	unsigned char data[2], can_buf[8];
+	wear_score_t score;
 	float flat, flon;
 	unsigned long age;
   
@@ -126,19 +157,42 @@ void loop() {
 			Serial.println();
 		}
 
-		accumulateWear(rpm_engine_value, vehicle_speed_value, 0);
+		accumulateWearT(&wear, micros(), rpm_engine_value, vehicle_speed_value, 0);	//taxas corrigidas pelo tempo real entre leituras
 		count++;
 
+		//evento brusco: envia na hora, a janela continua; dentro de EVENT_MIN_MS do
+		//ultimo so o mais grave fica pendente e sai quando o intervalo acabar
+		if (pending_event.type != 0 && (!event_sent || millis() - last_event_ms >= EVENT_MIN_MS))
+		{
+			msg[0] = EVENT_FLAG | pending_event.cls;
+			memcpy(msg+1, LASTVALIDLAT.b, 4);
+			memcpy(msg+5, LASTVALIDLON.b, 4);
+			memset(msg+SCORE_AT, 0, 3);
+			msg[EVENT_TYPE_AT] = pending_event.type;
+			sendPKG();
+			msg[EVENT_TYPE_AT] = 0;
+			pending_event.type = 0;
+			last_event_ms = millis();
+			event_sent = true;
+		}
+
 		smartdelay(100); // atualiza dados a cada 100ms
 	}
 
-	wearData(data);
-	memcpy(msg, data, 1);
-	memcpy(msg+1, LASTVALIDLAT.b, 4);
-	memcpy(msg+5, LASTVALIDLON.b, 4);
+	wearDataCtx(&wear, data);
+	wearScoreCtx(&wear, &score);
 	count = 0;
-	sendPKG();
-	resetWear(4);
+	if (wearReport(&report, data[0]))	//so envia se o desgaste mudou ou no heartbeat
+	{
+		memcpy(msg, data, 1);
+		memcpy(msg+1, LASTVALIDLAT.b, 4);
+		memcpy(msg+5, LASTVALIDLON.b, 4);
+		msg[SCORE_AT] = score.brake >> 2;	//no mesmo pacote, sem mensagem extra
+		msg[SCORE_AT+1] = score.clutch >> 2;
+		msg[SCORE_AT+2] = score.engine >> 2;
+		sendPKG();
+	}
+	resetWearCtx(&wear, 4);
 
 }
 
@@ -0,0 +1,56 @@
+#include <string.h>
+#include "wear_component.h"
+
+// a saida e montada num uint32_t
+WEAR_STATIC_ASSERT(wear_comp_bits, WEAR_COMP_BITS <= 32);
+
+// baldes indexados por unsigned char, score de 1 a 31 bits: out << 32 e indefinido
+#define COMP_CHECK(name, buckets, bits) \
+	WEAR_STATIC_ASSERT(name##_buckets, (buckets) > 0 && (buckets) <= 256 && (bits) > 0 && (bits) < 32);
+WEAR_COMPONENT_LIST(COMP_CHECK)
+
+#define COMP_INIT(name, buckets, bits)		name##Init(&c->name##_state);
+
+// classe fora dos baldes cai no ultimo: um Classify errado nao escreve fora do array
+#define COMP_ACCUMULATE(name, buckets, bits) \
+	if (name##Ready(b)) { \
+		for (size_t i = 0; i < n; i++) { \
+			unsigned char k = name##Classify(&c->name##_state, b, i); \
+			WEAR_INC(c->name[(k < (buckets))? k: (buckets) - 1]); \
+		} \
+	}
+
+#define COMP_RESET(name, buckets, bits)		memset(c->name, 0, sizeof(c->name));
+
+// mascara por deslocamento a direita: 1UL << 32 seria indefinido com long de 32 bits (AVR)
+#define COMP_PACK(name, buckets, bits)		out = (out << (bits)) | ((uint32_t) name##Score(c->name) & ((uint32_t) ~0 >> (32 - (bits))));
+
+
+void initWearComponents(wear_comp_t *c) {
+	memset(c, 0, sizeof(*c));
+	WEAR_COMPONENT_LIST(COMP_INIT)
+}
+
+
+void accumulateWearComponents(wear_comp_t *c, const wear_batch_t *b, size_t n) {
+	WEAR_COMPONENT_LIST(COMP_ACCUMULATE)
+	(void) c; (void) b; (void) n;
+}
+
+
+void resetWearComponents(wear_comp_t *c) {	//zera os histogramas, mantem o estado entre amostras
+	WEAR_COMPONENT_LIST(COMP_RESET)
+	(void) c;
+}
+
+
+void wearDataComponents(const wear_comp_t *c, unsigned char* data_ret) {
+	uint32_t out = 0;
+	int k;
+
+	WEAR_COMPONENT_LIST(COMP_PACK)
+	out <<= 8*WEAR_COMP_BYTES - WEAR_COMP_BITS;	//alinha aos bits altos do primeiro byte
+	for (k = 0; k < WEAR_COMP_BYTES; k++)
+		data_ret[k] = (unsigned char) (out >> 8*(WEAR_COMP_BYTES - 1 - k));
+	(void) c;
+}
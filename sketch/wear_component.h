@@ -0,0 +1,50 @@
+#ifndef WEAR_COMPONENT_H
+#define WEAR_COMPONENT_H
+
+#include "abrasion.h"
+
+/*
+ * Componentes de desgaste alem de freio, embreagem e motor, registrados em
+ * tempo de compilacao na lista de wear_components.h. Cada entrada
+ * X(nome, baldes, bits) pede, no header do componente, todos static inline:
+ *   nome##_state_t						estado entre amostras
+ *   void nome##Init(nome##_state_t *st)
+ *   char nome##Ready(const wear_batch_t *b)	o lote tem os sinais usados?
+ *   unsigned char nome##Classify(nome##_state_t *st, const wear_batch_t *b, size_t i)
+ *											de 0 a baldes - 1; acima disso conta no ultimo
+ *   char nome##Score(const wear_acc_t hist[])	de 0 a 2^bits - 1
+ * A lista e expandida em codigo direto, sem ponteiro de funcao: cada
+ * componente percorre o lote uma vez num laco proprio.
+ *
+ * Ainda nao ligado ao sketch.ino nem ao sketchSimu: o unico componente, pneu,
+ * pede aceleracao longitudinal e lateral, e nenhum dos dois tem acelerometro
+ * (so rpm e velocidade pelo CAN); e o pacote Sigfox de 12 bytes ja esta todo
+ * ocupado. Hoje so o abrasion_bench chama esta camada.
+ */
+
+typedef struct {	//lote em estrutura de arrays; sinal ausente e NULL
+	const int16_t *rpm, *spd, *brk;
+	const int16_t *accel_long, *accel_lat;	//cm/s^2
+} wear_batch_t;
+
+#include "wear_components.h"
+
+#define WEAR_COMP_FIELDS(name, buckets, bits)	wear_acc_t name[buckets]; name##_state_t name##_state;
+#define WEAR_COMP_BITS_OF(name, buckets, bits)	+ (bits)
+
+typedef struct {
+	WEAR_COMPONENT_LIST(WEAR_COMP_FIELDS)
+	char unused;	//a lista pode ser vazia
+} wear_comp_t;
+
+// saida empacotada como o byte principal: primeiro componente nos bits altos
+#define WEAR_COMP_BITS	(0 WEAR_COMPONENT_LIST(WEAR_COMP_BITS_OF))
+#define WEAR_COMP_BYTES	((WEAR_COMP_BITS + 7) / 8)
+
+void initWearComponents(wear_comp_t *c);
+void accumulateWearComponents(wear_comp_t *c, const wear_batch_t *b, size_t n);
+void resetWearComponents(wear_comp_t *c);
+// escreve WEAR_COMP_BYTES bytes em data_ret
+void wearDataComponents(const wear_comp_t *c, unsigned char* data_ret);
+
+#endif // WEAR_COMPONENT_H
@@ -0,0 +1,15 @@
+#ifndef WEAR_COMPONENTS_H
+#define WEAR_COMPONENTS_H
+
+/*
+ * Registro dos componentes extras, incluido por wear_component.h. Para
+ * adicionar um componente: incluir o header dele e acrescentar uma linha
+ * X(nome, baldes, bits) na lista.
+ */
+
+#include "wear_tire.h"
+
+#define WEAR_COMPONENT_LIST(X) \
+	X(tire, 4, 2)
+
+#endif // WEAR_COMPONENTS_H
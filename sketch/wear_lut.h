@@ -0,0 +1,60 @@
+#ifndef WEAR_LUT_H
+#define WEAR_LUT_H
+
+/*
+ * Tabelas de classificacao geradas pelo preprocessador a partir dos limiares
+ * de abrasion.h. Abaixo de t0 a classe e sempre 0 e acima de t2 sempre 3,
+ * entao cada tabela cobre so [t0, t0 + tamanho) e a entrada e saturada nesse
+ * intervalo antes da consulta. Incluir apenas em abrasion.c (e no
+ * bench/wear_check.c, que confere as tabelas).
+ */
+
+#include "abrasion.h"
+
+#define LUT_BUCKET(v, t0, t1, t2) (((v) > (t0)) + ((v) > (t1)) + ((v) > (t2)))
+
+#define LUT_REP2(F, i)		F(i) F((i) + 1)
+#define LUT_REP4(F, i)		LUT_REP2(F, i) LUT_REP2(F, (i) + 2)
+#define LUT_REP8(F, i)		LUT_REP4(F, i) LUT_REP4(F, (i) + 4)
+#define LUT_REP16(F, i)		LUT_REP8(F, i) LUT_REP8(F, (i) + 8)
+#define LUT_REP32(F, i)		LUT_REP16(F, i) LUT_REP16(F, (i) + 16)
+#define LUT_REP64(F, i)		LUT_REP32(F, i) LUT_REP32(F, (i) + 32)
+#define LUT_REP128(F, i)	LUT_REP64(F, i) LUT_REP64(F, (i) + 64)
+#define LUT_REP256(F, i)	LUT_REP128(F, i) LUT_REP128(F, (i) + 128)
+#define LUT_REP512(F, i)	LUT_REP256(F, i) LUT_REP256(F, (i) + 256)
+#define LUT_REP1024(F, i)	LUT_REP512(F, i) LUT_REP512(F, (i) + 512)
+#define LUT_REP2048(F, i)	LUT_REP1024(F, i) LUT_REP1024(F, (i) + 1024)
+
+// o tamanho precisa cobrir [t0, t2 + 1]
+#define LUT_CHECK(name, size, t0, t2) WEAR_STATIC_ASSERT(name##_lut_fits, (t2) - (t0) + 2 <= (size))
+
+#define RPM_LUT_SIZE		2048
+#define SPD_LUT_SIZE		16
+#define RPM_RATE_LUT_SIZE	32
+#define BRK_RATE_LUT_SIZE	64
+
+LUT_CHECK(rpm, RPM_LUT_SIZE, RPM_T0, RPM_T2);
+LUT_CHECK(spd, SPD_LUT_SIZE, SPD_T0, SPD_T2);
+LUT_CHECK(rpm_rate, RPM_RATE_LUT_SIZE, RPM_RATE_T0, RPM_RATE_T2);
+LUT_CHECK(brk_rate, BRK_RATE_LUT_SIZE, BRK_RATE_T0, BRK_RATE_T2);
+
+#define RPM_ENTRY(i)		LUT_BUCKET(RPM_T0 + (i), RPM_T0, RPM_T1, RPM_T2),
+#define SPD_ENTRY(i)		LUT_BUCKET(SPD_T0 + (i), SPD_T0, SPD_T1, SPD_T2),
+#define RPM_RATE_ENTRY(i)	LUT_BUCKET(RPM_RATE_T0 + (i), RPM_RATE_T0, RPM_RATE_T1, RPM_RATE_T2),
+#define BRK_RATE_ENTRY(i)	LUT_BUCKET(BRK_RATE_T0 + (i), BRK_RATE_T0, BRK_RATE_T1, BRK_RATE_T2),
+
+static const unsigned char RPM_LUT[RPM_LUT_SIZE] = {LUT_REP2048(RPM_ENTRY, 0)};
+static const unsigned char SPD_LUT[SPD_LUT_SIZE] = {LUT_REP16(SPD_ENTRY, 0)};
+static const unsigned char RPM_RATE_LUT[RPM_RATE_LUT_SIZE] = {LUT_REP32(RPM_RATE_ENTRY, 0)};
+static const unsigned char BRK_RATE_LUT[BRK_RATE_LUT_SIZE] = {LUT_REP64(BRK_RATE_ENTRY, 0)};
+
+
+static inline char lutClass(const unsigned char lut[], int value, int t0, int size) {	//sem desvios, vira cmov
+	int idx = value - t0;
+
+	idx = (idx < 0)? 0: idx;
+	idx = (idx > size - 1)? size - 1: idx;
+	return lut[idx];
+}
+
+#endif // WEAR_LUT_H
@@ -0,0 +1,84 @@
+#include <string.h>
+#include "wear_multi.h"
+
+
+void initWearMulti(wear_multi_t *m, const size_t sizes[], char k, wear_window_cb_t cb, void *user) {
+	initWear(&m->ctx);
+	m->k = (k > WEAR_MULTI_MAX)? WEAR_MULTI_MAX: k;
+	for (char j = 0; j < m->k; j++) {
+		m->size[j] = sizes[j];
+		m->fill[j] = 0;
+	}
+	memset(m->hist, 0, sizeof(m->hist));
+	m->on_window = cb;
+	m->user = user;
+}
+
+
+static void closeWindow(wear_multi_t *m, char j) {
+	unsigned char data[2];
+
+	wearDataProfile(&m->hist[j], WEAR_PROFILE(&m->ctx), data);
+	memset(&m->hist[j], 0, sizeof(m->hist[j]));
+	m->fill[j] = 0;
+	m->on_window(m->user, j, data[0]);
+}
+
+
+static void swapAtClose(wear_multi_t *m) {	//chamada quando alguma janela fechou
+	if (!swapWearProfile(&m->ctx))
+		return;
+	for (char j = 0; j < m->k; j++) {	//as abertas recomecam com o perfil novo
+		memset(&m->hist[j], 0, sizeof(m->hist[j]));
+		m->fill[j] = 0;
+	}
+}
+
+
+void accumulateWearMulti(wear_multi_t *m, short rpm, short spd, short brk) {
+	unsigned char cls = classifyWear(&m->ctx, rpm, spd, brk);
+	char closed = 0;
+
+	for (char j = 0; j < m->k; j++) {
+		addWearClass(&m->hist[j], cls);
+		if (++m->fill[j] == m->size[j]) {
+			closeWindow(m, j);
+			closed = 1;
+		}
+	}
+	if (closed)
+		swapAtClose(m);
+}
+
+
+void accumulateWearMultiBatch(wear_multi_t *m, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n) {
+	char closed;
+
+	while (n > 0) {
+		size_t step = n;
+
+		for (char j = 0; j < m->k; j++) {	//ate a proxima janela que fecha
+			if (m->size[j] - m->fill[j] < step)
+				step = m->size[j] - m->fill[j];
+		}
+
+		resetWearCtx(&m->ctx, 4);
+		accumulateWearBatch(&m->ctx, rpm, spd, brk, step);
+		closed = 0;
+		for (char j = 0; j < m->k; j++) {
+			mergeWearHist(&m->hist[j], &m->ctx.hist);
+			m->fill[j] += step;
+			if (m->fill[j] == m->size[j]) {
+				closeWindow(m, j);
+				closed = 1;
+			}
+		}
+		if (closed)
+			swapAtClose(m);
+
+		rpm += step;
+		spd += step;
+		brk += step;
+		n -= step;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef WEAR_MULTI_H
+#define WEAR_MULTI_H
+
+#include "abrasion.h"
+
+/*
+ * Varias janelas (tumbling) de tamanhos diferentes sobre o mesmo fluxo. A
+ * classificacao e feita uma vez por amostra e somada em cada janela; no lote
+ * o trecho ate a proxima janela que fecha passa uma vez por
+ * accumulateWearBatch e o histograma do trecho e somado em todas. Cada
+ * janela que fecha chama on_window com seu indice e o byte de desgaste. Um
+ * perfil pedido com requestWearProfile(&m->ctx, p) entra na primeira janela
+ * que fecha depois do pedido; as outras recomecam vazias nessa amostra, sem
+ * chamar on_window, e as amostras que tinham sao descartadas. Assim nenhuma
+ * janela mistura limiares e tabelas de dois perfis, e a troca nao espera
+ * todas fecharem juntas (o mmc dos tamanhos).
+ */
+
+#define WEAR_MULTI_MAX 4
+
+typedef void (*wear_window_cb_t)(void *user, char window, unsigned char data);
+
+typedef struct {
+	wear_ctx_t ctx;		//classifica uma vez para todas as janelas
+	char k;
+	size_t size[WEAR_MULTI_MAX], fill[WEAR_MULTI_MAX];
+	wear_hist_t hist[WEAR_MULTI_MAX];
+	wear_window_cb_t on_window;
+	void *user;
+} wear_multi_t;
+
+// k ate WEAR_MULTI_MAX, tamanhos maiores que 0
+void initWearMulti(wear_multi_t *m, const size_t sizes[], char k, wear_window_cb_t cb, void *user);
+void accumulateWearMulti(wear_multi_t *m, short rpm, short spd, short brk);
+void accumulateWearMultiBatch(wear_multi_t *m, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n);
+
+#endif // WEAR_MULTI_H
@@ -0,0 +1,100 @@
+#include "wear_profile.h"
+#include "wear_snapshot.h"
+
+#define THRESH_AT	4
+#define WEIGHT_AT	28
+#define TABLE_AT	40
+#define PROFILE_CRC	(WEAR_PROFILE_SIZE - 2)
+
+WEAR_STATIC_ASSERT(profile_tables, TABLE_AT + (BRAKE_WEAR_LEN + CLUTCH_WEAR_LEN + ENGINE_WEAR_LEN)/4 == PROFILE_CRC);
+WEAR_STATIC_ASSERT(profile_align, WEAR_PROFILE_SIZE % 4 == 0);
+
+
+static void putThresh(unsigned char *buf, const short t[]) {
+	for (int i = 0; i < 3; i++) {
+		buf[2*i] = (unsigned char) t[i];
+		buf[2*i + 1] = (unsigned char) ((unsigned short) t[i] >> 8);
+	}
+}
+
+
+static void getThresh(const unsigned char *buf, short t[]) {
+	for (int i = 0; i < 3; i++)
+		t[i] = (short) (buf[2*i] | (buf[2*i + 1] << 8));
+}
+
+
+static unsigned char *packTable(unsigned char *buf, const char table[], int len) {	//4 entradas por byte
+	for (int i = 0; i < len; i += 4)
+		*buf++ = (unsigned char) ((table[i] << 6) | (table[i + 1] << 4) | (table[i + 2] << 2) | table[i + 3]);
+	return buf;
+}
+
+
+static const unsigned char *unpackTable(const unsigned char *buf, char table[], int len) {
+	for (int i = 0; i < len; i++)
+		table[i] = (char) ((buf[i/4] >> (6 - 2*(i % 4))) & 0x3);
+	return buf + len/4;
+}
+
+
+void wearProfileEncode(const wear_profile_t *p, unsigned char *buf) {
+	unsigned char *t;
+
+	buf[0] = 'W';
+	buf[1] = 'P';
+	buf[2] = WEAR_PROFILE_VERSION;
+	buf[3] = 0;
+	putThresh(buf + THRESH_AT, p->rpm);
+	putThresh(buf + THRESH_AT + 6, p->spd);
+	putThresh(buf + THRESH_AT + 12, p->rpm_rate);
+	putThresh(buf + THRESH_AT + 18, p->brk_rate);
+	for (int i = 0; i < 4; i++) {
+		buf[WEIGHT_AT + i] = (unsigned char) p->rpm_weight[i];
+		buf[WEIGHT_AT + 4 + i] = (unsigned char) p->brake_weight[i];
+		buf[WEIGHT_AT + 8 + i] = (unsigned char) p->clutch_weight[i];
+	}
+	t = packTable(buf + TABLE_AT, p->brake_wear, BRAKE_WEAR_LEN);
+	t = packTable(t, p->clutch_wear, CLUTCH_WEAR_LEN);
+	packTable(t, p->engine_wear, ENGINE_WEAR_LEN);
+
+	unsigned short crc = wearCrc16(buf, PROFILE_CRC);
+	buf[PROFILE_CRC] = (unsigned char) crc;
+	buf[PROFILE_CRC + 1] = (unsigned char) (crc >> 8);
+}
+
+
+char wearProfileDecode(wear_profile_t *p, const unsigned char *buf) {
+	wear_profile_t out;
+	const unsigned char *t;
+
+	if (buf[0] != 'W' || buf[1] != 'P' || buf[2] != WEAR_PROFILE_VERSION
+			|| (buf[PROFILE_CRC] | (buf[PROFILE_CRC + 1] << 8)) != wearCrc16(buf, PROFILE_CRC))
+		return 0;
+
+	getThresh(buf + THRESH_AT, out.rpm);
+	getThresh(buf + THRESH_AT + 6, out.spd);
+	getThresh(buf + THRESH_AT + 12, out.rpm_rate);
+	getThresh(buf + THRESH_AT + 18, out.brk_rate);
+	for (int i = 0; i < 4; i++) {
+		out.rpm_weight[i] = (char) buf[WEIGHT_AT + i];
+		out.brake_weight[i] = (char) buf[WEIGHT_AT + 4 + i];
+		out.clutch_weight[i] = (char) buf[WEIGHT_AT + 8 + i];
+	}
+	t = unpackTable(buf + TABLE_AT, out.brake_wear, BRAKE_WEAR_LEN);
+	t = unpackTable(t, out.clutch_wear, CLUTCH_WEAR_LEN);
+	unpackTable(t, out.engine_wear, ENGINE_WEAR_LEN);
+
+	if (!checkWearProfile(&out))
+		return 0;
+	*p = out;
+	return 1;
+}
+
+
+unsigned short wearProfileId(const wear_profile_t *p) {
+	unsigned char buf[WEAR_PROFILE_SIZE];
+
+	wearProfileEncode(p, buf);
+	return (unsigned short) (buf[PROFILE_CRC] | (buf[PROFILE_CRC + 1] << 8));
+}
@@ -0,0 +1,28 @@
+#ifndef WEAR_PROFILE_H
+#define WEAR_PROFILE_H
+
+#include "abrasion.h"
+
+/*
+ * wear_profile_t em formato binario, little-endian, para trocar limiares,
+ * pesos e tabelas sem recompilar. O buffer pode estar em RAM, num arquivo
+ * lido pelo host ou direto na flash mapeada em memoria; decodifica para um
+ * wear_profile_t que o chamador mantem vivo enquanto o contexto o usar.
+ *
+ * WEAR_PROFILE_SIZE bytes:
+ *   0  'W' 'P'			4  rpm, spd, rpm_rate, brk_rate [3], i16
+ *   2  versao			28 rpm_weight, brake_weight, clutch_weight [4], u8
+ *   3  0				40 brake_wear, clutch_wear, engine_wear, 2 bits por
+ *   50 CRC-16/CCITT dos bytes 0..49	   entrada, a primeira nos bits altos
+ */
+
+#define WEAR_PROFILE_VERSION	1
+#define WEAR_PROFILE_SIZE		52
+
+void wearProfileEncode(const wear_profile_t *p, unsigned char *buf);
+// 1 se buf e valido e o perfil passa em checkWearProfile; senao 0 e p fica como estava
+char wearProfileDecode(wear_profile_t *p, const unsigned char *buf);
+// CRC da forma binaria: o mesmo para perfis iguais, qualquer que seja o endereco
+unsigned short wearProfileId(const wear_profile_t *p);
+
+#endif // WEAR_PROFILE_H
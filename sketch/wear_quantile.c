@@ -0,0 +1,261 @@
+#include <string.h>
+#include "wear_quantile.h"
+
+
+static unsigned char magBucket(unsigned short m) {
+	char k = 3;
+
+	if (m < QSKETCH_EXACT)
+		return m;
+
+	while (m >> (k + 1))	//k = log2(m)
+		k++;
+	return QSKETCH_EXACT + (k - 3)*QSKETCH_SUB + ((m >> (k - QSKETCH_SUB_BITS)) & (QSKETCH_SUB - 1));
+}
+
+
+static long magLow(unsigned char b) {	//menor magnitude do bucket
+	char k, sub;
+
+	if (b < QSKETCH_EXACT)
+		return b;
+
+	k = 3 + (b - QSKETCH_EXACT) / QSKETCH_SUB;
+	sub = (b - QSKETCH_EXACT) % QSKETCH_SUB;
+	return (long) (QSKETCH_SUB + sub) << (k - QSKETCH_SUB_BITS);
+}
+
+
+static unsigned char bucketOf(short value) {
+	if (value >= 0)
+		return QSKETCH_HALF + magBucket(value);
+	return QSKETCH_HALF - 1 - magBucket((unsigned short) -(long) value);
+}
+
+
+static void bucketRange(unsigned char b, long *lo, long *hi) {	//intervalo fechado de valores do bucket
+	if (b >= QSKETCH_HALF) {
+		b -= QSKETCH_HALF;
+		*lo = magLow(b);
+		*hi = magLow(b + 1) - 1;
+	}
+	else {
+		b = QSKETCH_HALF - 1 - b;
+		*lo = -(magLow(b + 1) - 1);
+		*hi = -magLow(b);
+	}
+}
+
+
+void initQsketch(qsketch_t *q) {
+	memset(q, 0, sizeof(qsketch_t));
+}
+
+
+void qsketchAdd(qsketch_t *q, short value) {
+	qsketch_count_t *c = &q->count[bucketOf(value)];
+
+	*c += (*c != QSKETCH_COUNT_MAX);	//saturado, como WEAR_INC
+}
+
+
+void qsketchMerge(qsketch_t *dst, const qsketch_t *src) {
+	for (int i = 0; i < QSKETCH_BUCKETS; i++) {
+		unsigned long sum = (unsigned long) dst->count[i] + src->count[i];
+
+		dst->count[i] = (sum > QSKETCH_COUNT_MAX)? QSKETCH_COUNT_MAX: (qsketch_count_t) sum;
+	}
+}
+
+
+typedef struct {	//contadores de um qsketch_t ou de um qsketch_wide_t, para as consultas
+	const qsketch_count_t *narrow;
+	const wear_wide_t *wide;
+} qcounts_t;
+
+
+static qcounts_t narrowCounts(const qsketch_t *q) {
+	qcounts_t c = {q->count, NULL};
+
+	return c;
+}
+
+
+static qcounts_t wideCounts(const qsketch_wide_t *q) {
+	qcounts_t c = {NULL, q->count};
+
+	return c;
+}
+
+
+static wear_wide_t countAt(const qcounts_t *c, int i) {
+	return (c->wide != NULL)? c->wide[i]: c->narrow[i];
+}
+
+
+static wear_wide_t countsTotal(const qcounts_t *c) {
+	wear_wide_t total = 0;
+
+	for (int i = 0; i < QSKETCH_BUCKETS; i++)
+		total += countAt(c, i);
+	return total;
+}
+
+
+static wear_wide_t countsRank(const qcounts_t *c, short value) {
+	unsigned char b = bucketOf(value);
+	wear_wide_t rank = 0;
+	long lo, hi;
+
+	for (int i = 0; i < b; i++)
+		rank += countAt(c, i);
+
+	bucketRange(b, &lo, &hi);	//parte do bucket de value, supondo distribuicao uniforme
+	return rank + countAt(c, b) * (value - lo + 1) / (hi - lo + 1);
+}
+
+
+static short countsQuantile(const qcounts_t *c, unsigned short permille) {
+	wear_wide_t total = countsTotal(c), target, rank = 0;
+	long lo, hi;
+	int i;
+
+	if (total == 0)
+		return 0;
+
+	target = (total * permille + 999) / 1000;
+	target = (target == 0)? 1: target;
+	for (i = 0; i < QSKETCH_BUCKETS - 1; i++) {
+		rank += countAt(c, i);
+		if (rank >= target)
+			break;
+	}
+
+	bucketRange(i, &lo, &hi);
+	lo = (lo + hi) / 2;
+	if (lo < -32768)	//a oitava 15 passa do alcance de short nos dois lados
+		return -32768;
+	return (lo > 32767)? 32767: (short) lo;
+}
+
+
+static void countsClasses(const qcounts_t *c, const short thresh[], wear_wide_t out[]) {
+	wear_wide_t below = 0, rank;
+
+	for (char i = 0; i < 3; i++) {
+		rank = countsRank(c, thresh[i]);
+		out[i] = rank - below;
+		below = rank;
+	}
+	out[3] = countsTotal(c) - below;
+}
+
+
+wear_wide_t qsketchTotal(const qsketch_t *q) {
+	qcounts_t c = narrowCounts(q);
+
+	return countsTotal(&c);
+}
+
+
+wear_wide_t qsketchRank(const qsketch_t *q, short value) {
+	qcounts_t c = narrowCounts(q);
+
+	return countsRank(&c, value);
+}
+
+
+short qsketchQuantile(const qsketch_t *q, unsigned short permille) {
+	qcounts_t c = narrowCounts(q);
+
+	return countsQuantile(&c, permille);
+}
+
+
+void qsketchClasses(const qsketch_t *q, const short thresh[], wear_wide_t out[]) {
+	qcounts_t c = narrowCounts(q);
+
+	countsClasses(&c, thresh, out);
+}
+
+
+void initQsketchWide(qsketch_wide_t *q) {
+	memset(q, 0, sizeof(qsketch_wide_t));
+}
+
+
+void qsketchWideAdd(qsketch_wide_t *dst, const qsketch_t *src) {
+	for (int i = 0; i < QSKETCH_BUCKETS; i++)
+		dst->count[i] += src->count[i];
+}
+
+
+void qsketchWideMerge(qsketch_wide_t *dst, const qsketch_wide_t *src) {
+	for (int i = 0; i < QSKETCH_BUCKETS; i++)
+		dst->count[i] += src->count[i];
+}
+
+
+wear_wide_t qsketchWideTotal(const qsketch_wide_t *q) {
+	qcounts_t c = wideCounts(q);
+
+	return countsTotal(&c);
+}
+
+
+wear_wide_t qsketchWideRank(const qsketch_wide_t *q, short value) {
+	qcounts_t c = wideCounts(q);
+
+	return countsRank(&c, value);
+}
+
+
+short qsketchWideQuantile(const qsketch_wide_t *q, unsigned short permille) {
+	qcounts_t c = wideCounts(q);
+
+	return countsQuantile(&c, permille);
+}
+
+
+void qsketchWideClasses(const qsketch_wide_t *q, const short thresh[], wear_wide_t out[]) {
+	qcounts_t c = wideCounts(q);
+
+	countsClasses(&c, thresh, out);
+}
+
+
+void initWearQuant(wear_quant_t *wq) {
+	memset(wq, 0, sizeof(wear_quant_t));
+}
+
+
+void addWearQuant(wear_quant_t *wq, short rpm, short spd, short brk, short d_rpm, short d_brk) {	//d_*: mesma variacao que e discretizada
+	qsketchAdd(&wq->rpm, rpm);
+	qsketchAdd(&wq->spd, spd);
+	qsketchAdd(&wq->brk, brk);
+	qsketchAdd(&wq->rpm_rate, d_rpm);
+	qsketchAdd(&wq->brk_rate, d_brk);
+}
+
+
+void mergeWearQuant(wear_quant_t *dst, const wear_quant_t *src) {
+	qsketchMerge(&dst->rpm, &src->rpm);
+	qsketchMerge(&dst->spd, &src->spd);
+	qsketchMerge(&dst->brk, &src->brk);
+	qsketchMerge(&dst->rpm_rate, &src->rpm_rate);
+	qsketchMerge(&dst->brk_rate, &src->brk_rate);
+}
+
+
+void initWearQuantWide(wear_quant_wide_t *wq) {
+	memset(wq, 0, sizeof(wear_quant_wide_t));
+}
+
+
+void addWearQuantWide(wear_quant_wide_t *dst, const wear_quant_t *src) {
+	qsketchWideAdd(&dst->rpm, &src->rpm);
+	qsketchWideAdd(&dst->spd, &src->spd);
+	qsketchWideAdd(&dst->brk, &src->brk);
+	qsketchWideAdd(&dst->rpm_rate, &src->rpm_rate);
+	qsketchWideAdd(&dst->brk_rate, &src->brk_rate);
+}
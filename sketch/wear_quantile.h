@@ -0,0 +1,81 @@
+#ifndef WEAR_QUANTILE_H
+#define WEAR_QUANTILE_H
+
+#include "abrasion.h"
+
+/*
+ * Sketch de quantis de tamanho fixo para um sinal de 16 bits. Magnitudes
+ * 0..7 tem bucket proprio; acima disso cada oitava [2^k, 2^(k+1)) e dividida
+ * em QSKETCH_SUB buckets: 4 por padrao, erro relativo abaixo de 12,5%, e 2 no
+ * AVR, abaixo de 25%. Negativos usam a mesma escala espelhada. Os contadores
+ * sao de 16 bits e saturam, independentes de WEAR_ACC_BITS: um sinal ocupa
+ * 240 bytes (136 no AVR) e um wear_quant_t 1200 (680), exatos ate 65535
+ * amostras por bucket (uma janela). qsketchMerge soma dois sketches e satura
+ * do mesmo jeito; agregados de muitas janelas ou veiculos (hora, vida util,
+ * frota) vao num qsketch_wide_t, com contadores wear_wide_t, somados com
+ * qsketchWideAdd, sem achatar os buckets dominantes. qsketchClasses reavalia
+ * limiares sem os dados brutos.
+ */
+
+#ifndef QSKETCH_SUB_BITS
+#if defined(__AVR__)
+#define QSKETCH_SUB_BITS	1
+#else
+#define QSKETCH_SUB_BITS	2
+#endif
+#endif
+
+#define QSKETCH_EXACT	8
+#define QSKETCH_SUB		(1 << QSKETCH_SUB_BITS)
+#define QSKETCH_HALF	(QSKETCH_EXACT + 13*QSKETCH_SUB)	//oitavas 3..15
+#define QSKETCH_BUCKETS	(2*QSKETCH_HALF)
+#define QSKETCH_BYTES	256		//limite por sinal
+
+typedef uint16_t qsketch_count_t;
+#define QSKETCH_COUNT_MAX UINT16_MAX
+
+typedef struct {
+	qsketch_count_t count[QSKETCH_BUCKETS];
+} qsketch_t;
+
+typedef struct {	//agregado de sketches
+	wear_wide_t count[QSKETCH_BUCKETS];
+} qsketch_wide_t;
+
+WEAR_STATIC_ASSERT(qsketch_sub, QSKETCH_SUB_BITS >= 0 && QSKETCH_SUB_BITS <= 3);	//a oitava 3 tem 8 valores
+WEAR_STATIC_ASSERT(qsketch_size, sizeof(qsketch_t) <= QSKETCH_BYTES);
+
+typedef struct wear_quant {	//um sketch por sinal, alimentado por classifyWear
+	qsketch_t rpm, spd, brk;
+	qsketch_t rpm_rate, brk_rate;
+} wear_quant_t;
+
+typedef struct {
+	qsketch_wide_t rpm, spd, brk;
+	qsketch_wide_t rpm_rate, brk_rate;
+} wear_quant_wide_t;
+
+void initQsketch(qsketch_t *q);
+void qsketchAdd(qsketch_t *q, short value);
+void qsketchMerge(qsketch_t *dst, const qsketch_t *src);
+wear_wide_t qsketchTotal(const qsketch_t *q);
+wear_wide_t qsketchRank(const qsketch_t *q, short value);	//estimativa de quantas amostras <= value
+short qsketchQuantile(const qsketch_t *q, unsigned short permille);
+void qsketchClasses(const qsketch_t *q, const short thresh[], wear_wide_t out[]);	//histograma que discretize daria
+
+// mesmas consultas sobre um agregado
+void initQsketchWide(qsketch_wide_t *q);
+void qsketchWideAdd(qsketch_wide_t *dst, const qsketch_t *src);
+void qsketchWideMerge(qsketch_wide_t *dst, const qsketch_wide_t *src);
+wear_wide_t qsketchWideTotal(const qsketch_wide_t *q);
+wear_wide_t qsketchWideRank(const qsketch_wide_t *q, short value);
+short qsketchWideQuantile(const qsketch_wide_t *q, unsigned short permille);
+void qsketchWideClasses(const qsketch_wide_t *q, const short thresh[], wear_wide_t out[]);
+
+void initWearQuant(wear_quant_t *wq);
+void addWearQuant(wear_quant_t *wq, short rpm, short spd, short brk, short d_rpm, short d_brk);
+void mergeWearQuant(wear_quant_t *dst, const wear_quant_t *src);
+void initWearQuantWide(wear_quant_wide_t *wq);
+void addWearQuantWide(wear_quant_wide_t *dst, const wear_quant_t *src);
+
+#endif // WEAR_QUANTILE_H
@@ -0,0 +1,56 @@
+#include "wear_report.h"
+
+
+void initWearReport(wear_report_t *r, unsigned short min_interval, unsigned short max_interval, unsigned char hysteresis) {
+	r->min_interval = min_interval;
+	r->max_interval = max_interval;
+	r->hysteresis = hysteresis;
+	r->last = 0;
+	r->streak = 0;
+	r->started = 0;
+	r->since = 0;
+}
+
+
+static char classDistance(unsigned char a, unsigned char b) {	//maior diferenca entre componentes
+	char d, max = 0;
+
+	d = WEAR_CLASS_BRAKE(a) - WEAR_CLASS_BRAKE(b);
+	max = (d < 0)? -d: d;
+	d = WEAR_CLASS_CLUTCH(a) - WEAR_CLASS_CLUTCH(b);
+	d = (d < 0)? -d: d;
+	max = (d > max)? d: max;
+	d = WEAR_CLASS_RPM(a) - WEAR_CLASS_RPM(b);
+	d = (d < 0)? -d: d;
+	return (d > max)? d: max;
+}
+
+
+char wearReport(wear_report_t *r, unsigned char data) {
+	char dist, send;
+
+	if (r->since < 0xFFFF)
+		r->since++;
+
+	dist = classDistance(data, r->last);
+	if (dist == 0)
+		r->streak = 0;
+	else if (r->streak < 0xFF)
+		r->streak++;
+
+	if (!r->started)	//primeiro valor sempre vai
+		send = 1;
+	else if (r->since < r->min_interval)
+		send = 0;
+	else
+		send = (dist >= 2) || (dist == 1 && r->streak >= r->hysteresis)
+			|| (r->max_interval != 0 && r->since >= r->max_interval);
+
+	if (send) {
+		r->started = 1;
+		r->last = data;
+		r->streak = 0;
+		r->since = 0;
+	}
+	return send;
+}
@@ -0,0 +1,27 @@
+#ifndef WEAR_REPORT_H
+#define WEAR_REPORT_H
+
+#include "abrasion.h"
+
+/*
+ * Decide se um byte de desgaste precisa ser enviado. Intervalos sao contados
+ * em chamadas de wearReport (uma por janela ou por amostra, a criterio do
+ * chamador). Uma mudanca de uma classe so e relatada depois de persistir por
+ * hysteresis chamadas seguidas; salto de duas classes ou mais e relatado
+ * direto. Nada sai antes de min_interval e, se max_interval != 0, o ultimo
+ * valor e repetido a cada max_interval chamadas como heartbeat.
+ */
+
+typedef struct {
+	unsigned short min_interval, max_interval;
+	unsigned char hysteresis;
+	unsigned char last;		//ultimo byte enviado
+	unsigned char streak;	//chamadas seguidas diferentes de last
+	unsigned char started;
+	unsigned short since;	//chamadas desde o ultimo envio
+} wear_report_t;
+
+void initWearReport(wear_report_t *r, unsigned short min_interval, unsigned short max_interval, unsigned char hysteresis);
+char wearReport(wear_report_t *r, unsigned char data);	//1 se data deve ser enviado
+
+#endif // WEAR_REPORT_H
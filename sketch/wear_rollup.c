@@ -0,0 +1,48 @@
+#include <string.h>
+#include "wear_rollup.h"
+
+static const unsigned long ROLLUP_SPAN_MS[WEAR_LEVELS] = {60000UL, 3600000UL, 0, 0};	//0: sem fechamento por tempo
+
+
+static void closeLevel(wear_rollup_t *r, char level) {
+	r->closed[level] = r->open[level];
+	memset(&r->open[level], 0, sizeof(wear_hist_t));
+	r->periods[level]++;
+}
+
+
+void initWearRollup(wear_rollup_t *r) {
+	memset(r, 0, sizeof(wear_rollup_t));
+}
+
+
+void wearRollupAdd(wear_rollup_t *r, const wear_hist_t *window, unsigned long window_ms) {	//chamar antes de resetWear
+	for (char i = 0; i < WEAR_LEVELS; i++) {
+		mergeWearHist(&r->open[i], window);
+
+		if (ROLLUP_SPAN_MS[i] == 0)
+			continue;
+
+		r->elapsed_ms[i] += window_ms;
+		if (r->elapsed_ms[i] >= ROLLUP_SPAN_MS[i]) {
+			closeLevel(r, i);
+			r->periods[i] += r->elapsed_ms[i] / ROLLUP_SPAN_MS[i] - 1;	//janela mais longa que o periodo
+			r->elapsed_ms[i] %= ROLLUP_SPAN_MS[i];
+		}
+	}
+}
+
+
+void wearRollupEndTrip(wear_rollup_t *r) {
+	closeLevel(r, WEAR_TRIP);
+}
+
+
+const wear_hist_t *wearRollupHist(const wear_rollup_t *r, char level, char closed) {
+	return closed? &r->closed[level]: &r->open[level];
+}
+
+
+void wearDataRollup(const wear_rollup_t *r, const wear_profile_t *p, char level, char closed, unsigned char* data_ret) {
+	wearDataProfile(wearRollupHist(r, level, closed), p, data_ret);
+}
@@ -0,0 +1,38 @@
+#ifndef WEAR_ROLLUP_H
+#define WEAR_ROLLUP_H
+
+#include "abrasion.h"
+
+/*
+ * Agrega os histogramas de cada janela em varias escalas de tempo, com
+ * memoria fixa. Minuto e hora fecham sozinhos pelo tempo das janelas (a
+ * fronteira cai no fim da janela que completa o periodo); a viagem fecha com
+ * wearRollupEndTrip e o total da vida util nunca fecha. Para cada nivel ha o
+ * periodo em andamento e o ultimo periodo fechado. Uma janela mais longa que
+ * o periodo fica inteira no periodo que ela fecha, e periods conta todos os
+ * que ela cobriu. wearDataRollup pontua com o perfil do contexto que gerou as
+ * janelas (WEAR_PROFILE(ctx)).
+ */
+
+enum {
+	WEAR_MINUTE,
+	WEAR_HOUR,
+	WEAR_TRIP,
+	WEAR_LIFETIME,
+	WEAR_LEVELS
+};
+
+typedef struct {
+	wear_hist_t open[WEAR_LEVELS];
+	wear_hist_t closed[WEAR_LEVELS];
+	unsigned long elapsed_ms[WEAR_LEVELS];
+	unsigned long periods[WEAR_LEVELS];	//periodos fechados ate agora
+} wear_rollup_t;
+
+void initWearRollup(wear_rollup_t *r);
+void wearRollupAdd(wear_rollup_t *r, const wear_hist_t *window, unsigned long window_ms);
+void wearRollupEndTrip(wear_rollup_t *r);
+const wear_hist_t *wearRollupHist(const wear_rollup_t *r, char level, char closed);
+void wearDataRollup(const wear_rollup_t *r, const wear_profile_t *p, char level, char closed, unsigned char* data_ret);
+
+#endif // WEAR_ROLLUP_H
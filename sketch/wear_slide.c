@@ -0,0 +1,43 @@
+#include "wear_slide.h"
+
+
+static void removeWearClass(wear_hist_t *hist, unsigned char cls) {
+	hist->brake[WEAR_CLASS_BRAKE(cls)] -= 1;
+	hist->clutch[WEAR_CLASS_CLUTCH(cls)] -= 1;
+	hist->rpm[WEAR_CLASS_RPM(cls)] -= 1;
+}
+
+
+char initWearSlide(wear_slide_t *s, unsigned char *ring, size_t len) {
+	initWear(&s->ctx);
+	s->ring = ring;
+	s->len = (ring != NULL)? len: 0;
+	s->head = 0;
+	s->fill = 0;
+	return s->len > 0;
+}
+
+
+void accumulateWearSlide(wear_slide_t *s, short rpm, short spd, short brk) {
+	unsigned char cls;
+
+	if (s->len == 0)	//sem anel nao ha onde guardar a classe
+		return;
+	cls = classifyWear(&s->ctx, rpm, spd, brk);
+
+	if (s->fill == s->len)	//janela cheia, a amostra mais antiga sai
+		removeWearClass(&s->ctx.hist, s->ring[s->head]);
+	else
+		s->fill++;
+
+	s->ring[s->head] = cls;
+	addWearClass(&s->ctx.hist, cls);
+
+	if (++s->head == s->len)
+		s->head = 0;
+}
+
+
+void wearDataSlide(wear_slide_t *s, unsigned char* data_ret) {
+	wearDataCtx(&s->ctx, data_ret);
+}
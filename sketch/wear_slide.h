@@ -0,0 +1,25 @@
+#ifndef WEAR_SLIDE_H
+#define WEAR_SLIDE_H
+
+#include "abrasion.h"
+
+/*
+ * Janela deslizante: o histograma cobre sempre as ultimas len amostras.
+ * A classe de cada amostra fica num anel fornecido pelo chamador (1 byte por
+ * amostra, sem heap); entrar e sair da janela custa O(1) e wearDataSlide
+ * pode ser chamado a qualquer momento. Com WEAR_ACC_BITS 16, len deve caber
+ * em WEAR_ACC_MAX. Com len 0 ou sem anel initWearSlide devolve 0 e a janela
+ * ignora as amostras.
+ */
+
+typedef struct {
+	wear_ctx_t ctx;
+	unsigned char *ring;
+	size_t len, head, fill;
+} wear_slide_t;
+
+char initWearSlide(wear_slide_t *s, unsigned char *ring, size_t len);	//1 se a janela e valida
+void accumulateWearSlide(wear_slide_t *s, short rpm, short spd, short brk);
+void wearDataSlide(wear_slide_t *s, unsigned char* data_ret);
+
+#endif // WEAR_SLIDE_H
@@ -0,0 +1,176 @@
+#include <string.h>
+#include "wear_snapshot.h"
+#include "wear_profile.h"
+
+#define HIST_SIZE	48	//12 contadores de 32 bits
+#define WINDOW_SIZE	(8 + HIST_SIZE)
+#define CTX_PROFILE	66
+#define CTX_CRC		(WEAR_SNAPSHOT_SIZE - 4)
+#define MULTI_CRC	(WEAR_MULTI_SNAPSHOT_SIZE - 4)
+
+WEAR_STATIC_ASSERT(snapshot_align, WEAR_SNAPSHOT_SIZE % 4 == 0 && WEAR_MULTI_SNAPSHOT_SIZE % 4 == 0);
+WEAR_STATIC_ASSERT(snapshot_window, WINDOW_SIZE == 56);
+
+
+static void putU16(unsigned char *p, uint16_t v) {
+	p[0] = (unsigned char) v;
+	p[1] = (unsigned char) (v >> 8);
+}
+
+
+static void putU32(unsigned char *p, uint32_t v) {
+	putU16(p, (uint16_t) v);
+	putU16(p + 2, (uint16_t) (v >> 16));
+}
+
+
+static uint16_t getU16(const unsigned char *p) {
+	return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+
+static uint32_t getU32(const unsigned char *p) {
+	return getU16(p) | ((uint32_t) getU16(p + 2) << 16);
+}
+
+
+static void putAcc(unsigned char *p, wear_acc_t v) {
+#if WEAR_ACC_BITS == 64
+	putU32(p, (v > UINT32_MAX)? UINT32_MAX: (uint32_t) v);	//satura em 32 bits
+#else
+	putU32(p, v);
+#endif
+}
+
+
+static wear_acc_t getAcc(const unsigned char *p) {
+	uint32_t v = getU32(p);
+
+#if WEAR_ACC_BITS == 16
+	return (v > WEAR_ACC_MAX)? WEAR_ACC_MAX: (wear_acc_t) v;	//snapshot de 32 bits num alvo de 16
+#else
+	return v;
+#endif
+}
+
+
+static void putHist(unsigned char *p, const wear_hist_t *hist) {
+	for (int i = 0; i < 4; i++) {
+		putAcc(p + 4*i, hist->brake[i]);
+		putAcc(p + 16 + 4*i, hist->clutch[i]);
+		putAcc(p + 32 + 4*i, hist->rpm[i]);
+	}
+}
+
+
+static void getHist(const unsigned char *p, wear_hist_t *hist) {
+	for (int i = 0; i < 4; i++) {
+		hist->brake[i] = getAcc(p + 4*i);
+		hist->clutch[i] = getAcc(p + 16 + 4*i);
+		hist->rpm[i] = getAcc(p + 32 + 4*i);
+	}
+}
+
+
+unsigned short wearCrc16(const unsigned char *buf, size_t len) {	//CRC-16/CCITT-FALSE, sem tabela
+	unsigned short crc = 0xFFFF;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= (unsigned short) (buf[i] << 8);
+		for (int b = 0; b < 8; b++)
+			crc = (crc & 0x8000)? (unsigned short) ((crc << 1) ^ 0x1021): (unsigned short) (crc << 1);
+	}
+
+	return crc;
+}
+
+
+static char validHeader(const unsigned char *buf, char kind, size_t crc_at) {
+	return buf[0] == 'W' && buf[1] == kind && buf[2] == WEAR_SNAPSHOT_VERSION
+		&& getU16(buf + crc_at) == wearCrc16(buf, crc_at);
+}
+
+
+void wearSnapshot(const wear_ctx_t *ctx, unsigned char *buf) {
+	buf[0] = 'W';
+	buf[1] = 'S';
+	buf[2] = WEAR_SNAPSHOT_VERSION;
+	buf[3] = ctx->has_t? 1: 0;
+	putHist(buf + 4, &ctx->hist);
+	putU16(buf + 52, (uint16_t) ctx->last_rpm);
+	putU16(buf + 54, (uint16_t) ctx->last_brk);
+	putU32(buf + 56, ctx->last_t_us);
+	putU16(buf + 60, (uint16_t) ctx->last_spd);
+	putU16(buf + 62, (uint16_t) ctx->last_acc);
+	buf[64] = (unsigned char) ctx->spd_seen;
+	buf[65] = (unsigned char) ctx->event_state;
+	putU16(buf + CTX_PROFILE, wearProfileId(WEAR_PROFILE(ctx)));
+	putU16(buf + CTX_CRC, wearCrc16(buf, CTX_CRC));
+	putU16(buf + CTX_CRC + 2, 0);
+}
+
+
+static char validCtx(const wear_ctx_t *ctx, const unsigned char *buf) {	//contado com o perfil de ctx?
+	return validHeader(buf, 'S', CTX_CRC) && getU16(buf + CTX_PROFILE) == wearProfileId(WEAR_PROFILE(ctx));
+}
+
+
+char wearRestore(wear_ctx_t *ctx, const unsigned char *buf) {
+	if (!validCtx(ctx, buf))
+		return 0;
+
+	ctx->has_t = buf[3] & 1;
+	getHist(buf + 4, &ctx->hist);
+	ctx->last_rpm = (short) getU16(buf + 52);
+	ctx->last_brk = (short) getU16(buf + 54);
+	ctx->last_t_us = getU32(buf + 56);
+	ctx->last_spd = (short) getU16(buf + 60);
+	ctx->last_acc = (short) getU16(buf + 62);
+	ctx->spd_seen = (char) buf[64];
+	ctx->event_state = (char) buf[65];
+	return 1;
+}
+
+
+void wearMultiSnapshot(const wear_multi_t *m, unsigned char *buf) {
+	memset(buf, 0, WEAR_MULTI_SNAPSHOT_SIZE);
+	buf[0] = 'W';
+	buf[1] = 'M';
+	buf[2] = WEAR_SNAPSHOT_VERSION;
+	buf[3] = (unsigned char) m->k;
+	wearSnapshot(&m->ctx, buf + 4);
+	for (char j = 0; j < m->k; j++) {
+		unsigned char *w = buf + 4 + WEAR_SNAPSHOT_SIZE + WINDOW_SIZE*j;
+
+		putU32(w, (uint32_t) m->size[j]);
+		putU32(w + 4, (uint32_t) m->fill[j]);
+		putHist(w + 8, &m->hist[j]);
+	}
+	putU16(buf + MULTI_CRC, wearCrc16(buf, MULTI_CRC));
+}
+
+
+char wearMultiRestore(wear_multi_t *m, const unsigned char *buf) {
+	char k = (char) buf[3];
+
+	if (!validHeader(buf, 'M', MULTI_CRC) || k < 1 || k > WEAR_MULTI_MAX || !validCtx(&m->ctx, buf + 4))
+		return 0;
+
+	for (char j = 0; j < k; j++) {	//tamanho 0 ou fill >= size travariam o lote
+		const unsigned char *w = buf + 4 + WEAR_SNAPSHOT_SIZE + WINDOW_SIZE*j;
+
+		if (getU32(w) == 0 || getU32(w + 4) >= getU32(w))
+			return 0;
+	}
+
+	wearRestore(&m->ctx, buf + 4);
+	m->k = k;
+	for (char j = 0; j < k; j++) {
+		const unsigned char *w = buf + 4 + WEAR_SNAPSHOT_SIZE + WINDOW_SIZE*j;
+
+		m->size[j] = getU32(w);
+		m->fill[j] = getU32(w + 4);
+		getHist(w + 8, &m->hist[j]);
+	}
+	return 1;
+}
@@ -0,0 +1,47 @@
+#ifndef WEAR_SNAPSHOT_H
+#define WEAR_SNAPSHOT_H
+
+#include "abrasion.h"
+#include "wear_multi.h"
+
+/*
+ * Estado do motor em formato binario fixo, little-endian, independente de
+ * WEAR_ACC_BITS (contadores sempre em 32 bits, saturados na ida e na volta).
+ * Serve para checkpoint, migrar um veiculo entre threads e retomar depois de
+ * reiniciar. Sem heap; os tamanhos sao multiplos de 4 para gravar direto em
+ * flash. Configuracao (quant, on_event, jerk_limit, callbacks) nao vai no
+ * snapshot: o chamador inicializa e depois restaura.
+ *
+ * O perfil tambem nao vai, so a identidade dele (wearProfileId): os
+ * histogramas so fazem sentido com os limiares que os contaram, entao a
+ * restauracao recusa um snapshot feito com outro perfil. Chamar
+ * setWearProfile antes de restaurar.
+ *
+ * wear_ctx_t, WEAR_SNAPSHOT_SIZE bytes:
+ *   0  'W' 'S'			4  hist brake[4] clutch[4] rpm[4], u32
+ *   2  versao			52 last_rpm, last_brk, i16
+ *   3  flags (bit0 has_t)	56 last_t_us, u32
+ *   60 last_spd, last_acc, i16	64 spd_seen, event_state, u8
+ *   66 wearProfileId do perfil, u16
+ *   68 CRC-16/CCITT dos bytes 0..67 e 2 bytes 0
+ *
+ * wear_multi_t, WEAR_MULTI_SNAPSHOT_SIZE bytes:
+ *   0 'W' 'M', 2 versao, 3 k (de 1 a WEAR_MULTI_MAX), 4 snapshot do ctx,
+ *   76 + 56*j: size, fill (u32) e hist da janela j, ate WEAR_MULTI_MAX janelas
+ *   no fim, CRC-16 de tudo antes dele e 2 bytes 0
+ */
+
+#define WEAR_SNAPSHOT_VERSION		2
+#define WEAR_SNAPSHOT_SIZE			72
+#define WEAR_MULTI_SNAPSHOT_SIZE	(4 + WEAR_SNAPSHOT_SIZE + 56*WEAR_MULTI_MAX + 4)
+
+unsigned short wearCrc16(const unsigned char *buf, size_t len);
+
+void wearSnapshot(const wear_ctx_t *ctx, unsigned char *buf);
+// 1 se buf e valido e do perfil de ctx; senao 0 e ctx fica como estava
+char wearRestore(wear_ctx_t *ctx, const unsigned char *buf);
+
+void wearMultiSnapshot(const wear_multi_t *m, unsigned char *buf);
+char wearMultiRestore(wear_multi_t *m, const unsigned char *buf);
+
+#endif // WEAR_SNAPSHOT_H
@@ -0,0 +1,43 @@
+#ifndef WEAR_TIRE_H
+#define WEAR_TIRE_H
+
+/*
+ * Desgaste de pneu pela aceleracao no plano, |longitudinal| + |lateral|
+ * (sem raiz quadrada). Componente de wear_component.h.
+ */
+
+#define TIRE_T0 150	//cm/s^2, ~0.15 g
+#define TIRE_T1 300
+#define TIRE_T2 450
+
+typedef struct {
+	char unused;	//a classe so depende da amostra
+} tire_state_t;
+
+
+static inline void tireInit(tire_state_t *st) {
+	st->unused = 0;
+}
+
+
+static inline char tireReady(const wear_batch_t *b) {
+	return b->accel_long != NULL && b->accel_lat != NULL;
+}
+
+
+static inline unsigned char tireClassify(tire_state_t *st, const wear_batch_t *b, size_t i) {
+	int a_long = b->accel_long[i], a_lat = b->accel_lat[i];
+	int a = ((a_long < 0)? -a_long: a_long) + ((a_lat < 0)? -a_lat: a_lat);
+
+	(void) st;
+	return (a > TIRE_T0) + (a > TIRE_T1) + (a > TIRE_T2);
+}
+
+
+static inline char tireScore(const wear_acc_t hist[]) {
+	static const char weight[] = {0, 1, 5, 8};	//os mesmos pesos do freio
+
+	return average(hist, weight);
+}
+
+#endif // WEAR_TIRE_H
@@ -0,0 +1,142 @@
+#include <string.h>
+#include "wear_trip.h"
+
+
+static void addHistDelta(wear_hist_t *dst, const wear_hist_t *now, const wear_hist_t *before) {
+	for (int i = 0; i < 4; i++) {
+		dst->brake[i] = wearAccAdd(dst->brake[i], (wear_acc_t) (now->brake[i] - before->brake[i]));
+		dst->clutch[i] = wearAccAdd(dst->clutch[i], (wear_acc_t) (now->clutch[i] - before->clutch[i]));
+		dst->rpm[i] = wearAccAdd(dst->rpm[i], (wear_acc_t) (now->rpm[i] - before->rpm[i]));
+	}
+}
+
+
+static void startTrip(wear_trip_t *t) {
+	memset(&t->trip, 0, sizeof(t->trip));
+	t->stop_run = 0;
+	t->in_trip = 1;
+}
+
+
+static char tripEvent(wear_trip_t *t, short spd) {	//evento desta amostra; abre a viagem se for o caso
+	if (spd > 0) {
+		t->stop_run = 0;
+		if (!t->in_trip) {
+			startTrip(t);
+			return WEAR_TRIP_START;
+		}
+	} else if (t->in_trip && ++t->stop_run >= t->stop_samples) {
+		return WEAR_TRIP_END;
+	}
+	return WEAR_TRIP_NONE;
+}
+
+
+static char addTripClass(wear_trip_t *t, char ev, unsigned char cls) {
+	addWearClass(&t->ctx->hist, cls);
+	if (t->in_trip) {
+		addWearClass(&t->trip.hist, cls);
+		t->trip.samples++;
+	}
+	if (ev == WEAR_TRIP_END)
+		t->in_trip = 0;
+	return ev;
+}
+
+
+void initWearTrip(wear_trip_t *t, wear_ctx_t *ctx, uint32_t stop_samples) {
+	t->ctx = ctx;
+	t->stop_samples = stop_samples;
+	t->stop_run = 0;
+	t->in_trip = 0;
+	memset(&t->trip, 0, sizeof(t->trip));
+}
+
+
+char accumulateWearTrip(wear_trip_t *t, short rpm, short spd, short brk) {
+	char ev = tripEvent(t, spd);
+
+	return addTripClass(t, ev, classifyWear(t->ctx, rpm, spd, brk));
+}
+
+
+char accumulateWearTripT(wear_trip_t *t, uint32_t t_us, short rpm, short spd, short brk) {
+	char ev = tripEvent(t, spd);
+
+	return addTripClass(t, ev, classifyWearT(t->ctx, t_us, rpm, spd, brk));
+}
+
+
+#define TRIP_BLOCK 32
+
+
+// amostras antes da proxima fronteira de viagem; a amostra que fecha a viagem entra.
+// Em blocos onde nao cabe um fim de viagem, so a primeira e a ultima amostra com
+// velocidade importam; as duas saem de reducoes sem desvio, que vetorizam
+static size_t tripSegment(wear_trip_t *t, const int16_t* spd, size_t n, char *ev) {
+	size_t k = 0;
+
+	while (k < n) {
+		if (n - k >= TRIP_BLOCK && (!t->in_trip || t->stop_run + TRIP_BLOCK < t->stop_samples)) {
+			unsigned first = TRIP_BLOCK, last = 0;	//last: 1 + indice da ultima com velocidade
+
+			for (unsigned j = 0; j < TRIP_BLOCK; j++) {
+				unsigned moving = spd[k + j] > 0;
+				unsigned f = moving? j: TRIP_BLOCK, l = moving*(j + 1);
+
+				first = (f < first)? f: first;
+				last = (l > last)? l: last;
+			}
+			if (!t->in_trip) {
+				if (first < TRIP_BLOCK) {
+					*ev = WEAR_TRIP_START;
+					return k + first;
+				}
+			} else {
+				t->stop_run = last? TRIP_BLOCK - last: t->stop_run + TRIP_BLOCK;
+			}
+			k += TRIP_BLOCK;
+			continue;
+		}
+
+		if (spd[k] > 0) {
+			if (!t->in_trip) {
+				*ev = WEAR_TRIP_START;
+				return k;
+			}
+			t->stop_run = 0;
+		} else if (t->in_trip && ++t->stop_run >= t->stop_samples) {
+			*ev = WEAR_TRIP_END;
+			return k + 1;
+		}
+		k++;
+	}
+
+	*ev = WEAR_TRIP_NONE;
+	return n;
+}
+
+
+// sem fronteira de viagem no trecho
+static void accumulateSegment(wear_trip_t *t, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n) {
+	wear_hist_t before = t->ctx->hist;
+
+	accumulateWearBatch(t->ctx, rpm, spd, brk, n);
+	if (t->in_trip) {
+		addHistDelta(&t->trip.hist, &t->ctx->hist, &before);
+		t->trip.samples += (uint32_t) n;
+	}
+}
+
+
+size_t accumulateWearTripBatch(wear_trip_t *t, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n, char *ev) {
+	size_t m = tripSegment(t, spd, n, ev);
+
+	accumulateSegment(t, rpm, spd, brk, m);
+	if (*ev == WEAR_TRIP_START)
+		startTrip(t);
+	else if (*ev == WEAR_TRIP_END)
+		t->in_trip = 0;
+
+	return m;
+}
@@ -0,0 +1,44 @@
+#ifndef WEAR_TRIP_H
+#define WEAR_TRIP_H
+
+#include "abrasion.h"
+
+/*
+ * Segmentacao em viagens na frente do motor de desgaste. A viagem comeca na
+ * primeira amostra com velocidade e termina apos stop_samples amostras
+ * paradas seguidas; cada uma tem seu resumo. accumulateWearTrip classifica
+ * como accumulateWearCtx e accumulateWearTripT como accumulateWearT.
+ * accumulateWearTripBatch so segmenta: cada trecho vai inteiro para
+ * accumulateWearBatch, cujo kernel vetorial soma os trechos de marcha lenta
+ * em bloco, e o resumo da viagem vem da diferenca de ctx->hist. Na fronteira
+ * de janela basta wearDataCtx e resetWearCtx.
+ */
+
+enum {
+	WEAR_TRIP_NONE = 0,
+	WEAR_TRIP_START,	//esta amostra abriu uma viagem
+	WEAR_TRIP_END		//esta amostra fechou a viagem, resumo em trip pronto
+};
+
+typedef struct {	//resumo de uma viagem
+	wear_hist_t hist;
+	uint32_t samples;
+} wear_trip_summary_t;
+
+typedef struct {
+	wear_ctx_t *ctx;
+	uint32_t stop_samples;
+	uint32_t stop_run;		//amostras paradas seguidas
+	char in_trip;
+	wear_trip_summary_t trip;	//viagem atual ou a ultima fechada
+} wear_trip_t;
+
+void initWearTrip(wear_trip_t *t, wear_ctx_t *ctx, uint32_t stop_samples);
+char accumulateWearTrip(wear_trip_t *t, short rpm, short spd, short brk);
+char accumulateWearTripT(wear_trip_t *t, uint32_t t_us, short rpm, short spd, short brk);
+// consome amostras ate a proxima fronteira de viagem e devolve quantas; em
+// WEAR_TRIP_START a viagem comeca em rpm[ret], em WEAR_TRIP_END a ultima
+// amostra consumida a fechou
+size_t accumulateWearTripBatch(wear_trip_t *t, const int16_t* rpm, const int16_t* spd, const int16_t* brk, size_t n, char *ev);
+
+#endif // WEAR_TRIP_H
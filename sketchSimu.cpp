@@ -1,88 +1,458 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
 #include <winsock2.h>
 #include <windows.h>
+#else
+#include <unistd.h>
+#define Sleep(ms) usleep((ms)*1000)
+#endif
 #include "./ipc/tcpclient.hpp"
+#include "./ipc/wearframe.hpp"
+#ifdef __linux__
+#include "./ipc/tcppoll.hpp"
+#endif
 #include "./sketch/abrasion.h"
+#include "./sketch/wear_report.h"
+#include "./sketch/wear_multi.h"
+#include "./sketch/wear_snapshot.h"
+#include "./sketch/wear_profile.h"
 
-const char IP[] = "192.168.25.5";	//MODIFIQUE O IP ANTES DE EXECUTAR
+const char IP[] = "192.168.25.5";	//MODIFIQUE O IP ANTES DE EXECUTAR (ou passe ip=...)
+const char STATE_FILE[] = "wear.state";	//janelas parciais salvas ao desconectar
+const int PORT = 5000;
+const int RING_SIZE = 16384;		//buffer de recepcao de cada veiculo, multiplo de RECV_RING_ALIGN
 
-unsigned short count;
+WEAR_STATIC_ASSERT(frame_fits, 2*(FRAME_HEADER + 2*FIELDS*FRAME_MAX) <= RING_SIZE);	//um lote inteiro cabe no anel mesmo antes de compactar
+WEAR_STATIC_ASSERT(ring_aligned, RING_SIZE % RECV_RING_ALIGN == 0);
+
+typedef struct {		//um veiculo simulado, com uma conexao propria
+	int id;
+	wear_multi_t wear;
+	wear_report_t report;
+	FILE *files[WEAR_MULTI_MAX];	//um arquivo por tamanho de janela
+	unsigned char window_data;		//byte da janela principal, a que e enviada
+	bool window_ready;
+	bool hello;						//cabecalho do servidor ja recebido
+	wear_ack_t ack;					//politica de ack pedida pelo servidor
+	frame_t frame;					//cabecalho ja lido, esperando o payload
+	bool framed;
+	bool closed;					//desconectado, estado ja salvo
+} vehicle_t;
+
+vehicle_t *vehicles;
+int n_vehicles = 1;					//mais de 1 so no Linux, todos na mesma thread com epoll
+bool events = false;				//envia so quando o desgaste muda
+bool verbose = false;				//log por amostra e delay de 100 ms por janela
+const char *profile_path = NULL;	//perfil binario (wear_profile.h), recarregado quando o arquivo muda
+wear_profile_t profiles[2];			//um em uso, o outro recebe a recarga
+int profile_slot = 0;
+time_t profile_mtime = 0;			//do ultimo perfil carregado
+time_t profile_bad = 0;				//do ultimo arquivo invalido, para avisar uma vez so
 
 void printHex(unsigned char *buf, char size);
-void decode(unsigned char *msg, short *rpm_engine_value, short *speed, short *brk);
+void onWindow(void *user, char window, unsigned char data);
+bool onSample(vehicle_t *v, short rpm_engine_value, short speed, short brk, unsigned char out[2]);
+void openVehicle(vehicle_t *v, int id, size_t sample[], int windows, bool resume);
+void closeVehicle(vehicle_t *v);
+void fileName(char *name, int id, const char *suffix);
+void saveState(const vehicle_t *v);
+bool loadState(vehicle_t *v);
+bool loadProfile(const char *path, wear_profile_t *p);
+void reloadProfile(const char *path);
+bool slotInUse(int slot);
+int runBlocking(const char *ip, vehicle_t *v);
+#ifdef __linux__
+int runPoll(const char *ip);
+#endif
 
 int main(int argc , char *argv[])
 {
-	unsigned char *server_reply, data[2];
-	short speed, rpm_engine_value, brk;
-	char ack[] = "ok";
-	FILE *wear = fopen("wear.txt", "w");
-	short sample = 1024;
+	size_t sample[WEAR_MULTI_MAX] = {1024};	//a primeira janela e a enviada, as outras so vao para arquivo
+	int windows = 1;
+	bool resume = false;	//continua as janelas salvas em STATE_FILE
+	const char *ip = IP;
+	int status;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "events") == 0)
+			events = true;
+		else if (strcmp(argv[i], "resume") == 0)
+			resume = true;
+		else if (strcmp(argv[i], "verbose") == 0)
+			verbose = true;
+		else if (strncmp(argv[i], "profile=", 8) == 0)
+			profile_path = argv[i] + 8;
+		else if (strncmp(argv[i], "ip=", 3) == 0)
+			ip = argv[i] + 3;
+		else if (strncmp(argv[i], "vehicles=", 9) == 0)
+			n_vehicles = atoi(argv[i] + 9);
+		else if (atoi(argv[i]) > 0 && windows < WEAR_MULTI_MAX)
+			sample[windows++] = atoi(argv[i]);	//janelas extras para calibracao, na mesma passada
+	}
+#ifndef __linux__
+	if (n_vehicles != 1)
+	{
+		printf("vehicles= so e suportado no Linux.\n");
+		return 1;
+	}
+#endif
+	if (n_vehicles < 1)
+		n_vehicles = 1;
+
+	if (profile_path != NULL && !loadProfile(profile_path, &profiles[0]))
+	{
+		printf("Perfil invalido: %s\n", profile_path);
+		return 1;
+	}
+	vehicles = (vehicle_t *) calloc(n_vehicles, sizeof(vehicle_t));
+	if (vehicles == NULL)
+		return 1;
+	for (int k = 0; k < n_vehicles; k++)
+		openVehicle(&vehicles[k], k, sample, windows, resume);
+
+	initWINSOCK();
+#ifdef __linux__
+	if (n_vehicles > 1 || !verbose)
+		status = runPoll(ip);
+	else
+#endif
+		status = runBlocking(ip, &vehicles[0]);
+
+	free(vehicles);
+	return status;
+}
+
 
-	fprintf(wear, "wear = {sample_size: %d, values = [\n", sample);
+int runBlocking(const char *ip, vehicle_t *v)	//um veiculo, recv bloqueante (Windows ou verbose)
+{
+	unsigned char *server_reply, *payload, data[2], ack[ACK_SIZE];
+	short speed, rpm_engine_value, brk;
+	int len;
+	frame_t frame;
+	alignas(RECV_RING_ALIGN) char ring_buf[RING_SIZE];
+	recv_ring_t ring;
 
 	/* Inicialização do socket TCP */
 	SOCKET scoket;
-	initWINSOCK();
 	initSocket(&scoket);
-	connect(scoket, IP, 5000); //ip do localhost
+	connect(scoket, ip, PORT); //ip do localhost
+	initRecvRing(&ring, ring_buf, RING_SIZE);
 	//
 
+	server_reply = (unsigned char *) recData(scoket, &ring, HELLO_SIZE);
+	if(server_reply == NULL || !(v->hello = readHello(&v->ack, server_reply)))
+	{
+		printf("Servidor sem o protocolo esperado.\n");
+		closeVehicle(v);
+		closesocket(scoket);
+		return 1;
+	}
+
 	while(true)
 	{
-		count = 0;
-		while(count < sample)
+		//sem lote na fila o servidor pode estar esperando o ack para mandar mais
+		if(ring.len < FRAME_HEADER && pendingData(scoket) == 0 && (len = ackMessage(&v->ack, true, ack)) > 0)
+			sendData(scoket, (char*) ack, len);
+
+		//recData espera o tamanho pedido, entao cabecalho e payload chegam inteiros, direto do anel
+		server_reply = (unsigned char *) recData(scoket, &ring, FRAME_HEADER);
+		if(server_reply == NULL || !readFrame(&frame, server_reply)
+				|| (payload = (unsigned char *) recData(scoket, &ring, frame.length)) == NULL)
 		{
-			server_reply = (unsigned char *) recData(scoket, 6, true);
-			if(server_reply == NULL)
+			printf("Servidor desconectado.\n");
+			closeVehicle(v);
+			closesocket(scoket);
+			return 0;
+		}
+
+		for(int i = 0; i < frame.count; i++)
+		{
+			decode(&frame, payload, i, &rpm_engine_value, &speed, &brk);
+			if(verbose)
+				printf("%d %d %d\n", rpm_engine_value, speed, brk);
+			if(onSample(v, rpm_engine_value, speed, brk, data))
 			{
-				printf("Servidor desconectado.\n");
-				fprintf(wear, "]}");
-				return 0;
+				sendData(scoket, (char*) data, 1);
+
+				printf("Data sent: ");
+				printHex(data, 1);
+				if(verbose)
+					Sleep(100);				//delay pra ver o q ta acontecendo
 			}
-			sendData(scoket, ack);
+		}
+		if((len = ackMessage(&v->ack, false, ack)) > 0)
+			sendData(scoket, (char*) ack, len);
+	}
 
-			decode(server_reply, &rpm_engine_value, &speed, &brk);
+	return 0;
+}
 
-			accumulateWear(rpm_engine_value, speed, brk);
-			count += 1;
-		}
 
-		wearData(data);				//calcula o desgaste e guarda na variavel data
-		fprintf(wear, "{brake: %u, clutch: %u, engine: %u},\n", data[0]>>4, (data[0]>>2) & 0x3, data[0] & 0x3);
-		data[0] = data[0] | 0xC0;	//envia pelo menos 2 bits com 1 por conta do tcp
-		sendData(scoket, (char*) data);
-		
-		printf("Data sent: ");
-		printHex(data, 1);
-		Sleep(100);				//delay pra ver o q ta acontecendo
+#ifdef __linux__
+int runPoll(const char *ip)	//todos os veiculos numa thread, padrao no Linux; sem delay nem log por amostra
+{
+	tcp_poll_t poll;
+	tcp_conn_t *conn, *ready[64];
+	unsigned char *msg, data[2], ack[ACK_SIZE];
+	short speed, rpm_engine_value, brk;
+	int open = 0, len;
+	char *rings;
 
-		resetWear(4);
+	conn = (tcp_conn_t *) calloc(n_vehicles, sizeof(tcp_conn_t));
+	rings = (char *) aligned_alloc(RECV_RING_ALIGN, (size_t) n_vehicles*RING_SIZE);	//um anel por veiculo
+	if (conn == NULL || rings == NULL || initPoll(&poll) != 0)
+	{
+		free(conn);
+		free(rings);
+		return 1;
 	}
+	for (int k = 0; k < n_vehicles; k++)
+	{
+		initRecvRing(&conn[k].ring, rings + (size_t) k*RING_SIZE, RING_SIZE);
+		if (connect(&poll, &conn[k], ip, PORT, &vehicles[k]) == 0)
+			open++;
+		else
+			closeVehicle(&vehicles[k]);
+	}
+
+	while (open > 0)
+	{
+		int n = waitPoll(&poll, ready, 64, -1);
 
+		for (int i = 0; i < n; i++)
+		{
+			tcp_conn_t *c = ready[i];
+			vehicle_t *v = (vehicle_t *) c->user;
+			bool bad = false;
+
+			//cabecalho e payload podem chegar picados; o que falta fica no buffer da conexao.
+			//O FIN pode vir junto com os ultimos lotes: le ate NULL e so depois olha closed
+			while (!bad && (msg = (unsigned char *) recData(c, !v->hello? HELLO_SIZE: v->framed? v->frame.length: FRAME_HEADER)) != NULL)
+			{
+				if (!v->hello || !v->framed)
+				{
+					bool ok;
+
+					if (!v->hello)
+						ok = v->hello = readHello(&v->ack, msg);
+					else
+						ok = v->framed = readFrame(&v->frame, msg);
+					if (!ok)
+					{
+						printf("Veiculo %d: servidor sem o protocolo esperado.\n", v->id);
+						bad = true;
+					}
+					continue;
+				}
+				v->framed = false;
+				for (int j = 0; j < v->frame.count; j++)
+				{
+					decode(&v->frame, msg, j, &rpm_engine_value, &speed, &brk);
+					if (onSample(v, rpm_engine_value, speed, brk, data))
+						sendData(c, (char*) data, 1);
+				}
+				if ((len = ackMessage(&v->ack, false, ack)) > 0)
+					sendData(c, (char*) ack, len);
+			}
+			if (!bad && !c->closed && (len = ackMessage(&v->ack, true, ack)) > 0)	//leu tudo o que havia
+				sendData(c, (char*) ack, len);
+			if ((bad || c->closed) && c->s != INVALID_SOCKET)
+			{
+				printf("Veiculo %d desconectado.\n", v->id);
+				closeConn(&poll, c);
+				closeVehicle(v);
+				open--;
+			}
+		}
+	}
+
+	closePoll(&poll);
+	free(conn);
+	free(rings);
 	return 0;
 }
+#endif
 
 
-void decode(unsigned char *msg, short *rpm_engine_value, short *speed, short *brk)	//decodifica os dados enviados do servidor
+bool onSample(vehicle_t *v, short rpm_engine_value, short speed, short brk, unsigned char out[2])	//true se out deve ser enviado
 {
-	int i = 0;
-	unsigned char str[] = {msg[0], msg[1], msg[2], msg[3], msg[4], msg[5]};
-	*rpm_engine_value = 0;
-	*speed = 0;
-	*brk = 0;
+	accumulateWearMulti(&v->wear, rpm_engine_value, speed, brk);
+	v->ack.seq++;
+	if(!v->window_ready)
+		return false;
+	v->window_ready = false;
+	if (profile_path != NULL)
+		reloadProfile(profile_path);
 
-	printHex(str, 6);
+	out[0] = v->window_data;
+	out[1] = '\0';
+	if(events && !wearReport(&v->report, out[0]))
+		return false;
+	out[0] = out[0] | 0xC0;	//envia pelo menos 2 bits com 1 por conta do tcp
+	return true;
+}
 
-	*rpm_engine_value = (msg[0] << 8) | msg[1];
-	
-	*speed = (msg[2] << 8) | msg[3];
 
-	*brk = (msg[4] << 8) | msg[5];
+void onWindow(void *user, char window, unsigned char data)	//chamada ao fim de cada janela
+{
+	vehicle_t *v = (vehicle_t *) user;
 
-	printf("\n");
-	return;
+	fprintf(v->files[(int) window], "{brake: %u, clutch: %u, engine: %u},\n", data>>4, (data>>2) & 0x3, data & 0x3);
+	if(window == 0)
+	{
+		v->window_data = data;
+		v->window_ready = true;
+	}
+}
+
+
+void fileName(char *name, int id, const char *suffix)	//wear<suffix> no veiculo 0, wear-v<id><suffix> nos outros
+{
+	if (id == 0)
+		sprintf(name, "wear%s", suffix);
+	else
+		sprintf(name, "wear-v%d%s", id, suffix);
+}
+
+
+void openVehicle(vehicle_t *v, int id, size_t sample[], int windows, bool resume)
+{
+	size_t size[WEAR_MULTI_MAX];
+
+	memcpy(size, sample, sizeof(size));
+	v->id = id;
+	initWearReport(&v->report, 1, 30, 2);
+	initWearMulti(&v->wear, size, (char) windows, onWindow, v);
+	if (profile_path != NULL)	//antes de restaurar: estado salvo com outro perfil e recusado
+		setWearProfile(&v->wear.ctx, &profiles[profile_slot]);
+	if (resume && loadState(v))
+	{
+		windows = v->wear.k;	//os tamanhos salvos valem sobre os da linha de comando
+		for (int w = 0; w < windows; w++)
+			size[w] = v->wear.size[w];
+		if (n_vehicles == 1)
+			printf("Estado restaurado de %s.\n", STATE_FILE);
+	}
+
+	for (int w = 0; w < windows; w++)
+	{
+		char name[48], suffix[24];
+
+		if (w == 0)
+			strcpy(suffix, ".txt");
+		else
+			sprintf(suffix, "-%u.txt", (unsigned) size[w]);
+		fileName(name, id, suffix);
+		v->files[w] = fopen(name, "w");
+		fprintf(v->files[w], "wear = {sample_size: %u, values = [\n", (unsigned) size[w]);
+	}
+}
+
+
+void closeVehicle(vehicle_t *v)
+{
+	v->closed = true;	//reloadProfile nao espera mais por ele
+	saveState(v);
+	for (int w = 0; w < v->wear.k; w++)
+	{
+		fprintf(v->files[w], "]}");
+		fclose(v->files[w]);
+	}
+}
+
+
+void saveState(const vehicle_t *v)	//STATE_FILE no veiculo 0, wear-v<id>.state nos outros
+{
+	unsigned char buf[WEAR_MULTI_SNAPSHOT_SIZE];
+	char name[48];
+	FILE *f;
+
+	fileName(name, v->id, ".state");
+	if ((f = fopen(name, "wb")) == NULL)
+		return;
+	wearMultiSnapshot(&v->wear, buf);
+	fwrite(buf, 1, sizeof(buf), f);
+	fclose(f);
+}
+
+
+bool loadState(vehicle_t *v)	//false se o arquivo nao existe, esta corrompido ou e de outro perfil
+{
+	unsigned char buf[WEAR_MULTI_SNAPSHOT_SIZE];
+	char name[48];
+	FILE *f;
+	size_t len;
+
+	fileName(name, v->id, ".state");
+	if ((f = fopen(name, "rb")) == NULL)
+		return false;
+	len = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	return len == sizeof(buf) && wearMultiRestore(&v->wear, buf);
+}
+
+
+bool loadProfile(const char *path, wear_profile_t *p)	//false se o arquivo nao existe ou esta corrompido
+{
+	unsigned char buf[WEAR_PROFILE_SIZE];
+	struct stat st;
+	bool have_mtime = stat(path, &st) == 0;	//antes de ler: se mudar durante a leitura, a proxima tentativa pega
+	FILE *f = fopen(path, "rb");
+	size_t len;
+
+	if (f == NULL)
+		return false;
+	len = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	if (len != sizeof(buf) || !wearProfileDecode(p, buf))
+		return false;	//arquivo pela metade: tenta de novo na proxima janela
+	if (have_mtime)
+		profile_mtime = st.st_mtime;
+	return true;
+}
+
+
+bool slotInUse(int slot)	//algum veiculo conectado ainda usa ou espera o perfil do slot
+{
+	for (int k = 0; k < n_vehicles; k++)
+	{
+		const wear_ctx_t *ctx = &vehicles[k].wear.ctx;
+
+		if (!vehicles[k].closed && (ctx->profile == &profiles[slot] || ctx->next_profile == &profiles[slot]))
+			return true;
+	}
+	return false;
+}
+
+
+void reloadProfile(const char *path)	//se o arquivo mudou, o perfil novo entra na proxima janela que fechar em cada veiculo
+{
+	struct stat st;
+	int next = 1 - profile_slot;
+
+	if (stat(path, &st) != 0 || st.st_mtime == profile_mtime)
+		return;
+	if (slotInUse(next))
+		return;	//o perfil anterior ainda esta em uso: tenta de novo na proxima janela
+	if (loadProfile(path, &profiles[next]))
+	{
+		for (int k = 0; k < n_vehicles; k++)
+		{
+			if (!vehicles[k].closed)
+				requestWearProfile(&vehicles[k].wear.ctx, &profiles[next]);
+		}
+		profile_slot = next;
+		printf("Perfil recarregado de %s.\n", path);
+	}
+	else if (st.st_mtime != profile_bad)
+	{
+		printf("Perfil invalido, mantendo o atual: %s\n", path);
+		profile_bad = st.st_mtime;
+	}
 }
 
 